@@ -0,0 +1,112 @@
+#include "AssetLoader.hpp"
+#include "GeometryBuffer.hpp"
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <unordered_map>
+
+namespace gps {
+
+    AssetLoader::AssetLoader(ThreadPool& pool) : pool(pool) {
+    }
+
+    void AssetLoader::addModel(Model3D& model, std::string fileName) {
+
+        requests.push_back({&model, std::move(fileName)});
+    }
+
+    void AssetLoader::loadAll() {
+
+        auto start = std::chrono::steady_clock::now();
+
+        // 1. parse every model in parallel; each parse job queues its model's BVH build behind it,
+        //    so those overlap the other models and the uploads below
+        std::vector<std::future<void>> parseJobs;
+        parseJobs.reserve(requests.size());
+        for (const auto& request : requests) {
+
+            Model3D* model = request.model;
+            std::string fileName = request.fileName;
+            ThreadPool* workers = &pool;
+            parseJobs.push_back(pool.submit([model, fileName, workers]() {
+                model->Prepare(fileName);
+                model->StartQueryData(*workers);
+            }));
+        }
+
+        // 2. as each model finishes parsing, queue its images for decoding so decoding overlaps with
+        //    the parsing of the remaining models; images already in the texture cache are skipped
+        std::unordered_map<std::string, std::shared_future<std::shared_ptr<const TextureCache::DecodedImage>>> decodeJobs;
+        std::vector<std::vector<std::string>> modelTextures(requests.size());
+        for (size_t i = 0; i < requests.size(); i++) {
+
+            try {
+                parseJobs[i].get();
+            }
+            catch (...) {
+                // the other jobs still write into their models, let them finish before giving up
+                for (size_t j = 0; j < requests.size(); j++) {
+                    if (j > i) {
+                        try {
+                            parseJobs[j].get();
+                        }
+                        catch (...) {
+                            continue;
+                        }
+                    }
+                    if (j != i) {
+                        requests[j].model->FinishQueryData();
+                    }
+                }
+                requests.clear();
+                throw;
+            }
+
+            for (const auto& path : requests[i].model->GetTexturePaths()) {
+
+                std::string key = TextureCache::canonicalPath(path);
+                if (TextureCache::isResident(key)) {
+                    continue;
+                }
+
+                modelTextures[i].push_back(key);
+                if (decodeJobs.find(key) == decodeJobs.end()) {
+
+                    decodeJobs.emplace(key, pool.submit([key]() { return TextureCache::decode(key); }).share());
+                }
+            }
+
+            // this thread is not a worker, so it can wait on the chunk jobs of a pooled walk grid build;
+            // models that aren't walked on return straight away
+            requests[i].model->BuildWalkGrid(&pool);
+        }
+
+        // 3. upload model by model on this thread while later images are still decoding
+        for (size_t i = 0; i < requests.size(); i++) {
+
+            TextureCache::DecodedImageMap images;
+            for (const auto& key : modelTextures[i]) {
+
+                images.emplace(key, decodeJobs.at(key).get());
+            }
+            requests[i].model->FinishLoading(images);
+        }
+        GeometryBuffer::commit();
+
+        // 4. the BVH builds queued by the parse jobs
+        for (const auto& request : requests) {
+
+            request.model->FinishQueryData();
+        }
+
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Loaded " << requests.size() << " models and " << decodeJobs.size() << " images on "
+                  << pool.size() << " worker threads in " << elapsedMs << " ms" << std::endl;
+
+        TextureCache::printStats();
+        GeometryBuffer::printStats();
+
+        requests.clear();
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef AssetLoader_hpp
+#define AssetLoader_hpp
+
+#include "Model3D.hpp"
+#include "ThreadPool.hpp"
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Loads a batch of models through the worker pool: OBJ parsing and image
+    // decoding run on the workers, buffer/texture uploads stay on the calling (GL) thread.
+    class AssetLoader {
+
+    public:
+        explicit AssetLoader(ThreadPool& pool);
+
+        void addModel(Model3D& model, std::string fileName);
+
+        // Blocks until every queued model is uploaded. A model that fails to parse is rethrown here,
+        // on the calling thread, as the std::runtime_error from Model3D::Prepare
+        void loadAll();
+
+    private:
+        struct ModelRequest {
+            Model3D* model;
+            std::string fileName;
+        };
+
+        ThreadPool& pool;
+        std::vector<ModelRequest> requests;
+    };
+}
+
+#endif /* AssetLoader_hpp */
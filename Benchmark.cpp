@@ -0,0 +1,555 @@
+#include "Benchmark.hpp"
+#include "Model3D.hpp"
+#include "ThreadPool.hpp"
+#include "WalkGrid.hpp"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace gps {
+
+    namespace {
+
+        double elapsedMs(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // The byte-by-byte swap ReadTextureFromFile used to run on every image
+        void legacyRowFlip(unsigned char* image_data, int x, int y) {
+
+            int width_in_bytes = x * 4;
+            unsigned char *top = NULL;
+            unsigned char *bottom = NULL;
+            unsigned char temp = 0;
+            int half_height = y / 2;
+
+            for (int row = 0; row < half_height; row++) {
+
+                top = image_data + row * width_in_bytes;
+                bottom = image_data + (y - row - 1) * width_in_bytes;
+
+                for (int col = 0; col < width_in_bytes; col++) {
+
+                    temp = *top;
+                    *top = *bottom;
+                    *bottom = temp;
+                    top++;
+                    bottom++;
+                }
+            }
+        }
+
+        struct WalkTriangle {
+            glm::vec3 v0;
+            glm::vec3 v1;
+            glm::vec3 v2;
+        };
+
+        // The floor classification ReadOBJ used to run single-threaded for every model it parsed
+        std::vector<WalkTriangle> legacyWalkTriangles(const Model3D::ModelData& data, float normalThreshold) {
+
+            std::vector<WalkTriangle> walkTriangles;
+            for (const auto& mesh : data.meshes) {
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    const glm::vec3 v0 = mesh.vertices[mesh.indices[i]].Position;
+                    const glm::vec3 v1 = mesh.vertices[mesh.indices[i + 1]].Position;
+                    const glm::vec3 v2 = mesh.vertices[mesh.indices[i + 2]].Position;
+
+                    const glm::vec3 n = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+                    if (n.y < normalThreshold) {
+                        continue;
+                    }
+                    walkTriangles.push_back({v0, v1, v2});
+                }
+            }
+            return walkTriangles;
+        }
+
+        // three vertices per triangle, as Model3D hands them to WalkGrid and TriangleBVH
+        std::vector<glm::vec3> triangleVertices(const Model3D::ModelData& data) {
+
+            std::vector<glm::vec3> vertices;
+            for (const auto& mesh : data.meshes) {
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    vertices.push_back(mesh.vertices[mesh.indices[i]].Position);
+                    vertices.push_back(mesh.vertices[mesh.indices[i + 1]].Position);
+                    vertices.push_back(mesh.vertices[mesh.indices[i + 2]].Position);
+                }
+            }
+            return vertices;
+        }
+
+        // The walk grid Model3D used to keep: one heap-allocated index list per cell,
+        // scalar barycentric test per triangle, shared triangles retested in every neighbour cell
+        class LegacyWalkGrid {
+
+        public:
+            LegacyWalkGrid(const std::vector<WalkTriangle>& triangles, const glm::vec3& boundsMin,
+                           const glm::vec3& boundsMax, float cellSize)
+                : triangles(triangles), cellSize(cellSize) {
+
+                origin = glm::vec2(boundsMin.x, boundsMin.z);
+                width = static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / cellSize)) + 1;
+                height = static_cast<int>(std::ceil((boundsMax.z - boundsMin.z) / cellSize)) + 1;
+                cells.assign(width * height, {});
+
+                for (size_t t = 0; t < triangles.size(); ++t) {
+                    const WalkTriangle& tri = triangles[t];
+                    int ix0 = static_cast<int>(std::floor((std::min({tri.v0.x, tri.v1.x, tri.v2.x}) - origin.x) / cellSize));
+                    int ix1 = static_cast<int>(std::floor((std::max({tri.v0.x, tri.v1.x, tri.v2.x}) - origin.x) / cellSize));
+                    int iz0 = static_cast<int>(std::floor((std::min({tri.v0.z, tri.v1.z, tri.v2.z}) - origin.y) / cellSize));
+                    int iz1 = static_cast<int>(std::floor((std::max({tri.v0.z, tri.v1.z, tri.v2.z}) - origin.y) / cellSize));
+                    ix0 = std::clamp(ix0, 0, width - 1);
+                    ix1 = std::clamp(ix1, 0, width - 1);
+                    iz0 = std::clamp(iz0, 0, height - 1);
+                    iz1 = std::clamp(iz1, 0, height - 1);
+
+                    for (int iz = iz0; iz <= iz1; ++iz) {
+                        for (int ix = ix0; ix <= ix1; ++ix) {
+                            cells[iz * width + ix].push_back(static_cast<int>(t));
+                        }
+                    }
+                }
+            }
+
+            bool getHeightAt(float x, float z, float currentY, float& outHeight) const {
+
+                int ix = static_cast<int>(std::floor((x - origin.x) / cellSize));
+                int iz = static_cast<int>(std::floor((z - origin.y) / cellSize));
+                if (ix < 0 || ix >= width || iz < 0 || iz >= height) {
+                    return false;
+                }
+
+                const float eps = 1e-4f;
+                float bestDiff = std::numeric_limits<float>::max();
+                bool found = false;
+
+                for (int dz = -1; dz <= 1; ++dz) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        int cx = ix + dx;
+                        int cz = iz + dz;
+                        if (cx < 0 || cx >= width || cz < 0 || cz >= height) {
+                            continue;
+                        }
+
+                        for (int triIndex : cells[cz * width + cx]) {
+                            const WalkTriangle& tri = triangles[triIndex];
+                            const glm::vec2 a(tri.v0.x, tri.v0.z);
+                            const glm::vec2 v0 = glm::vec2(tri.v1.x, tri.v1.z) - a;
+                            const glm::vec2 v1 = glm::vec2(tri.v2.x, tri.v2.z) - a;
+                            const glm::vec2 v2 = glm::vec2(x, z) - a;
+
+                            float denom = v0.x * v1.y - v1.x * v0.y;
+                            if (std::abs(denom) < eps) {
+                                continue;
+                            }
+
+                            float v = (v2.x * v1.y - v1.x * v2.y) / denom;
+                            float w = (v0.x * v2.y - v2.x * v0.y) / denom;
+                            float u = 1.0f - v - w;
+                            if (u < -eps || v < -eps || w < -eps) {
+                                continue;
+                            }
+
+                            float y = u * tri.v0.y + v * tri.v1.y + w * tri.v2.y;
+                            float diff = std::abs(y - currentY);
+                            if (diff < bestDiff) {
+                                bestDiff = diff;
+                                outHeight = y;
+                                found = true;
+                            }
+                        }
+                    }
+                }
+                return found;
+            }
+
+        private:
+            const std::vector<WalkTriangle>& triangles;
+            float cellSize;
+            int width = 0;
+            int height = 0;
+            glm::vec2 origin{};
+            std::vector<std::vector<int>> cells;
+        };
+
+        // Every triangle, the reference for the BVH
+        bool bruteForceRaycast(const Model3D::ModelData& data, const glm::vec3& origin, const glm::vec3& direction,
+                               float maxDistance, float& outDistance) {
+
+            bool found = false;
+            outDistance = maxDistance;
+            for (const auto& mesh : data.meshes) {
+                for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                    const glm::vec3 v0 = mesh.vertices[mesh.indices[i]].Position;
+                    const glm::vec3 edge1 = mesh.vertices[mesh.indices[i + 1]].Position - v0;
+                    const glm::vec3 edge2 = mesh.vertices[mesh.indices[i + 2]].Position - v0;
+
+                    const glm::vec3 p = glm::cross(direction, edge2);
+                    const float det = glm::dot(edge1, p);
+                    if (det == 0.0f) {
+                        continue;
+                    }
+                    const float invDet = 1.0f / det;
+                    const glm::vec3 s = origin - v0;
+                    const float u = glm::dot(s, p) * invDet;
+                    const glm::vec3 q = glm::cross(s, edge1);
+                    const float v = glm::dot(direction, q) * invDet;
+                    const float t = glm::dot(edge2, q) * invDet;
+                    if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < outDistance) {
+                        outDistance = t;
+                        found = true;
+                    }
+                }
+            }
+            return found;
+        }
+
+        bool isImageFile(const std::filesystem::path& path) {
+            std::string extension = path.extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga";
+        }
+
+        // nearest-rank percentile of an ascending sample list
+        double percentile(const std::vector<double>& sorted, double fraction) {
+            if (sorted.empty()) {
+                return 0.0;
+            }
+            size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+            return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+        }
+
+        std::string jsonString(const std::string& text) {
+            std::string quoted = "\"";
+            for (char c : text) {
+                if (c == '"' || c == '\\') {
+                    quoted += '\\';
+                }
+                if (static_cast<unsigned char>(c) >= 0x20) {
+                    quoted += c;
+                }
+            }
+            return quoted + "\"";
+        }
+    }
+
+    int Benchmark::textureFlip(const std::string& rootDir) {
+
+        std::vector<std::filesystem::path> files;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(rootDir, ec)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+
+        if (files.empty()) {
+            std::cerr << "No images found under " << rootDir << std::endl;
+            return 1;
+        }
+
+        double totalDecodeMs = 0.0;
+        double totalFlipMs = 0.0;
+        std::cout << std::fixed << std::setprecision(3);
+
+        for (const auto& file : files) {
+
+            int x, y, n;
+            auto decodeStart = std::chrono::steady_clock::now();
+            unsigned char* image_data = stbi_load(file.string().c_str(), &x, &y, &n, 4);
+            double decodeMs = elapsedMs(decodeStart);
+            if (!image_data) {
+                std::cerr << "ERROR: could not load " << file.string() << std::endl;
+                continue;
+            }
+
+            auto flipStart = std::chrono::steady_clock::now();
+            legacyRowFlip(image_data, x, y);
+            double flipMs = elapsedMs(flipStart);
+            stbi_image_free(image_data);
+
+            totalDecodeMs += decodeMs;
+            totalFlipMs += flipMs;
+            std::cout << file.string() << " " << x << "x" << y
+                      << "  decode " << decodeMs << " ms, row flip " << flipMs << " ms saved" << std::endl;
+        }
+
+        std::cout << files.size() << " images: decode " << totalDecodeMs << " ms, row flip "
+                  << totalFlipMs << " ms saved (" << totalFlipMs / files.size() << " ms per texture)" << std::endl;
+        return 0;
+    }
+
+    int Benchmark::walkHeight(const std::string& objFileName) {
+
+        // CPU half of loading only, no GL context needed
+        Model3D model;
+        try {
+            model.Prepare(objFileName);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        const Model3D::ModelData& data = model.GetPreparedData();
+        const std::vector<glm::vec3> vertices = triangleVertices(data);
+
+        const float minFloorNormalY = 0.6f;
+        const float cellSize = 0.5f;
+        ThreadPool pool;
+
+        // classification included on both sides, it used to run in ReadOBJ
+        auto buildStart = std::chrono::steady_clock::now();
+        std::vector<WalkTriangle> walkTriangles = legacyWalkTriangles(data, minFloorNormalY);
+        LegacyWalkGrid legacy(walkTriangles, data.bounds.min, data.bounds.max, cellSize);
+        double legacyBuildMs = elapsedMs(buildStart);
+
+        buildStart = std::chrono::steady_clock::now();
+        WalkGrid grid;
+        grid.build(vertices, minFloorNormalY, data.bounds.min, data.bounds.max, cellSize);
+        double buildMs = elapsedMs(buildStart);
+
+        buildStart = std::chrono::steady_clock::now();
+        WalkGrid pooledGrid;
+        pooledGrid.build(vertices, minFloorNormalY, data.bounds.min, data.bounds.max, cellSize, &pool);
+        double pooledBuildMs = elapsedMs(buildStart);
+
+        if (grid.getTriangleCount() == 0) {
+            std::cerr << "No walkable triangles in " << objFileName << std::endl;
+            return 1;
+        }
+
+        // fixed seed: every run queries the same points
+        const size_t queryCount = 1000000;
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> randomX(data.bounds.min.x, data.bounds.max.x);
+        std::uniform_real_distribution<float> randomY(data.bounds.min.y, data.bounds.max.y);
+        std::uniform_real_distribution<float> randomZ(data.bounds.min.z, data.bounds.max.z);
+        std::vector<glm::vec3> queries(queryCount);
+        for (glm::vec3& query : queries) {
+            query = glm::vec3(randomX(random), randomY(random), randomZ(random));
+        }
+
+        std::vector<float> heights(queryCount, 0.0f);
+        std::vector<float> legacyHeights(queryCount, 0.0f);
+        std::vector<char> hits(queryCount, 0);
+        std::vector<char> legacyHits(queryCount, 0);
+
+        auto queryStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < queryCount; i++) {
+            hits[i] = grid.getHeightAt(queries[i].x, queries[i].z, queries[i].y, heights[i]);
+        }
+        double queryMs = elapsedMs(queryStart);
+
+        queryStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < queryCount; i++) {
+            legacyHits[i] = legacy.getHeightAt(queries[i].x, queries[i].z, queries[i].y, legacyHeights[i]);
+        }
+        double legacyQueryMs = elapsedMs(queryStart);
+
+        size_t hitCount = 0;
+        size_t mismatches = 0;
+        for (size_t i = 0; i < queryCount; i++) {
+            hitCount += hits[i] ? 1 : 0;
+            if (hits[i] != legacyHits[i] || (hits[i] && std::abs(heights[i] - legacyHeights[i]) > 1e-3f)) {
+                mismatches++;
+            }
+            // the pooled build lays out the same grid, so its answers are bit-identical
+            float pooledHeight = 0.0f;
+            bool pooledHit = pooledGrid.getHeightAt(queries[i].x, queries[i].z, queries[i].y, pooledHeight);
+            if (pooledHit != (hits[i] != 0) || (pooledHit && pooledHeight != heights[i])) {
+                mismatches++;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << objFileName << ": " << grid.getTriangleCount() << " walkable triangles, "
+                  << grid.getCellCount() << " cells, " << grid.getEntryCount() << " cell entries" << std::endl;
+        std::cout << "  build: flat grid " << buildMs << " ms, on " << pool.size() << " workers " << pooledBuildMs
+                  << " ms, nested lists " << legacyBuildMs << " ms" << std::endl;
+        std::cout << "  " << queryCount << " queries (" << hitCount << " hits): flat grid "
+                  << queryCount / (queryMs / 1000.0) / 1.0e6 << " M queries/s, nested lists "
+                  << queryCount / (legacyQueryMs / 1000.0) / 1.0e6 << " M queries/s ("
+                  << legacyQueryMs / queryMs << "x)" << std::endl;
+        std::cout << "  mismatches: " << mismatches << std::endl;
+
+        // batch API: shuffled so the cell sort has work to do, with a share of points off the grid
+        std::shuffle(queries.begin(), queries.end(), random);
+        for (size_t i = 0; i < queryCount; i += 16) {
+            queries[i].x = data.bounds.max.x + 1.0f + randomX(random) - data.bounds.min.x;
+        }
+        for (size_t i = 0; i < queryCount; i++) {
+            hits[i] = grid.getHeightAt(queries[i].x, queries[i].z, queries[i].y, heights[i]);
+        }
+
+        std::vector<float> batchHeights(queryCount);
+        std::vector<uint8_t> batchHits(queryCount);
+        for (ThreadPool* batchPool : {static_cast<ThreadPool*>(nullptr), &pool}) {
+
+            std::fill(batchHeights.begin(), batchHeights.end(), 0.0f);
+            std::fill(batchHits.begin(), batchHits.end(), 0);
+            queryStart = std::chrono::steady_clock::now();
+            grid.getHeightsAt(queries, batchHeights, batchHits, batchPool);
+            double batchMs = elapsedMs(queryStart);
+
+            size_t batchMismatches = 0;
+            for (size_t i = 0; i < queryCount; i++) {
+                if ((batchHits[i] != 0) != (hits[i] != 0) || (hits[i] && batchHeights[i] != heights[i])) {
+                    batchMismatches++;
+                }
+            }
+            mismatches += batchMismatches;
+
+            std::cout << "  batch" << (batchPool ? " on " + std::to_string(pool.size()) + " workers" : "") << ": "
+                      << queryCount / (batchMs / 1000.0) / 1.0e6 << " M queries/s, "
+                      << batchMismatches << " differ from getHeightAt" << std::endl;
+        }
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    int Benchmark::raycast(const std::string& objFileName) {
+
+        // CPU side of loading only, no GL context needed
+        Model3D model;
+        model.setPickable(true);
+        try {
+            model.Prepare(objFileName);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        model.BuildQueryData();
+        const Model3D::ModelData& data = model.GetPreparedData();
+
+        const size_t rayCount = 200000;
+        const size_t checkedRays = 2000;
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> randomX(data.bounds.min.x, data.bounds.max.x);
+        std::uniform_real_distribution<float> randomY(data.bounds.min.y, data.bounds.max.y);
+        std::uniform_real_distribution<float> randomZ(data.bounds.min.z, data.bounds.max.z);
+        std::uniform_real_distribution<float> randomUnit(-1.0f, 1.0f);
+
+        // from a point inside the bounds, with the length of the bounds' diagonal
+        const float rayLength = glm::length(data.bounds.max - data.bounds.min);
+        std::vector<glm::vec3> origins(rayCount);
+        std::vector<glm::vec3> directions(rayCount);
+        for (size_t i = 0; i < rayCount; i++) {
+            origins[i] = glm::vec3(randomX(random), randomY(random), randomZ(random));
+            glm::vec3 direction(randomUnit(random), randomUnit(random), randomUnit(random));
+            directions[i] = glm::length(direction) > 1e-3f ? glm::normalize(direction) : glm::vec3(0.0f, -1.0f, 0.0f);
+        }
+
+        std::vector<RayHit> hits(rayCount);
+        std::vector<char> hitFlags(rayCount, 0);
+        auto queryStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rayCount; i++) {
+            hitFlags[i] = model.raycast(origins[i], directions[i], rayLength, hits[i]);
+        }
+        double closestMs = elapsedMs(queryStart);
+
+        size_t occludedCount = 0;
+        queryStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rayCount; i++) {
+            occludedCount += model.occluded(origins[i], directions[i], rayLength) ? 1 : 0;
+        }
+        double anyHitMs = elapsedMs(queryStart);
+
+        size_t hitCount = 0;
+        for (char flag : hitFlags) {
+            hitCount += flag ? 1 : 0;
+        }
+
+        size_t mismatches = occludedCount == hitCount ? 0 : 1;
+        double bruteForceMs = 0.0;
+        for (size_t i = 0; i < checkedRays; i++) {
+            float distance;
+            auto bruteForceStart = std::chrono::steady_clock::now();
+            bool found = bruteForceRaycast(data, origins[i], directions[i], rayLength, distance);
+            bruteForceMs += elapsedMs(bruteForceStart);
+            if (found != (hitFlags[i] != 0) || (found && std::abs(distance - hits[i].distance) > 1e-4f * rayLength)) {
+                mismatches++;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << objFileName << ": " << rayCount << " rays (" << hitCount << " hits)" << std::endl;
+        std::cout << "  closest hit " << closestMs * 1000.0 / rayCount << " us/ray, any hit "
+                  << anyHitMs * 1000.0 / rayCount << " us/ray, every triangle "
+                  << bruteForceMs * 1000.0 / checkedRays << " us/ray" << std::endl;
+        std::cout << "  mismatches against every triangle (" << checkedRays << " rays) and any hit: "
+                  << mismatches << std::endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    bool Benchmark::writeFlythroughReport(const std::string& path, const FlythroughReport& report) {
+
+        std::vector<double> sorted = report.frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        double totalMs = 0.0;
+        for (double ms : sorted) {
+            totalMs += ms;
+        }
+        double meanMs = sorted.empty() ? 0.0 : totalMs / sorted.size();
+
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Could not write benchmark report " << path << std::endl;
+            return false;
+        }
+
+        file << std::fixed << std::setprecision(3);
+        file << "{" << std::endl;
+        file << "  \"renderer\": " << jsonString(report.renderer) << "," << std::endl;
+        file << "  \"resolution\": [" << report.width << ", " << report.height << "]," << std::endl;
+        file << "  \"frames\": " << sorted.size() << "," << std::endl;
+        file << "  \"time_step_ms\": " << report.timeStepMs << "," << std::endl;
+        file << "  \"frame_ms\": {\"mean\": " << meanMs
+             << ", \"min\": " << (sorted.empty() ? 0.0 : sorted.front())
+             << ", \"p50\": " << percentile(sorted, 0.50)
+             << ", \"p90\": " << percentile(sorted, 0.90)
+             << ", \"p95\": " << percentile(sorted, 0.95)
+             << ", \"p99\": " << percentile(sorted, 0.99)
+             << ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "}," << std::endl;
+        file << "  \"triangles_per_frame\": {\"scene\": " << report.sceneTriangles
+             << ", \"shadow\": " << report.shadowTriangles << "}," << std::endl;
+        file << "  \"draw_calls_per_frame\": " << report.drawCalls << "," << std::endl;
+
+        // zone times are per frame; gpu_ms is null where the driver returned no timestamps
+        file << "  \"passes\": [";
+        unsigned frames = std::max(report.zoneFrames, 1u);
+        for (size_t i = 0; i < report.zones.size(); i++) {
+            const Profiler::ZoneStats& zone = report.zones[i];
+            file << (i == 0 ? "" : ",") << std::endl
+                 << "    {\"name\": " << jsonString(zone.name) << ", \"depth\": " << zone.depth
+                 << ", \"cpu_ms\": " << zone.cpuMs / frames << ", \"gpu_ms\": ";
+            if (zone.gpuSamples > 0) {
+                file << zone.gpuMs / frames;
+            }
+            else {
+                file << "null";
+            }
+            file << "}";
+        }
+        file << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "Benchmark: " << sorted.size() << " frames, mean " << meanMs << " ms, p50 "
+                  << percentile(sorted, 0.50) << " ms, p99 " << percentile(sorted, 0.99) << " ms -> "
+                  << path << std::endl;
+        return true;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef Benchmark_hpp
+#define Benchmark_hpp
+
+#include "Profiler.hpp"
+
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Command line micro-benchmarks; each returns a process exit code
+    class Benchmark {
+
+    public:
+        // Decodes every image under rootDir and times the per-image CPU row flip
+        // that texture loading used to do after stbi_load (now replaced by flipped texcoords)
+        static int textureFlip(const std::string& rootDir);
+
+        // Random floor height queries against a model's walk grid, timed against the
+        // per-cell index lists getHeightAt used to walk, then through the batch API serially and
+        // on the pool; reports queries per second and fails unless the batch results match the scalar ones exactly
+        static int walkHeight(const std::string& objFileName);
+
+        // Random rays through a model's bounds against its BVH: microseconds per closest-hit and any-hit query,
+        // with a share of the rays checked against testing every triangle
+        static int raycast(const std::string& objFileName);
+
+        // What a --benchmark flythrough measured; counts are per-frame averages
+        struct FlythroughReport {
+            std::string renderer;
+            int width = 0;
+            int height = 0;
+            double timeStepMs = 0.0;
+            std::vector<double> frameMs;
+            double sceneTriangles = 0.0;
+            double shadowTriangles = 0.0;
+            double drawCalls = 0.0;
+            std::vector<Profiler::ZoneStats> zones;
+            unsigned zoneFrames = 0;
+        };
+
+        // Frame-time percentiles, counts and per-zone timings as JSON, plus a console summary
+        static bool writeFlythroughReport(const std::string& path, const FlythroughReport& report);
+    };
+}
+
+#endif /* Benchmark_hpp */
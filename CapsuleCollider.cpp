@@ -0,0 +1,257 @@
+#include "CapsuleCollider.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace gps {
+
+    namespace {
+
+        // longer sweeps take bigger steps rather than more of them
+        const int MAX_STEPS = 32;
+        // contacts resolved per step, one per pass; corners take two
+        const int MAX_PASSES = 6;
+        // left between the capsule and a surface it was pushed off, as a fraction of the radius
+        const float SKIN = 1e-3f;
+
+        // Closest point to p on triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+        glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+
+            const glm::vec3 ab = b - a;
+            const glm::vec3 ac = c - a;
+            const glm::vec3 ap = p - a;
+            const float d1 = glm::dot(ab, ap);
+            const float d2 = glm::dot(ac, ap);
+            if (d1 <= 0.0f && d2 <= 0.0f) {
+                return a;
+            }
+
+            const glm::vec3 bp = p - b;
+            const float d3 = glm::dot(ab, bp);
+            const float d4 = glm::dot(ac, bp);
+            if (d3 >= 0.0f && d4 <= d3) {
+                return b;
+            }
+
+            const float vc = d1 * d4 - d3 * d2;
+            if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+                return a + ab * (d1 / (d1 - d3));
+            }
+
+            const glm::vec3 cp = p - c;
+            const float d5 = glm::dot(ab, cp);
+            const float d6 = glm::dot(ac, cp);
+            if (d6 >= 0.0f && d5 <= d6) {
+                return c;
+            }
+
+            const float vb = d5 * d2 - d1 * d6;
+            if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+                return a + ac * (d2 / (d2 - d6));
+            }
+
+            const float va = d3 * d6 - d5 * d4;
+            if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+                return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            }
+
+            const float denom = 1.0f / (va + vb + vc);
+            return a + ab * (vb * denom) + ac * (vc * denom);
+        }
+
+        // Closest points of segments p1q1 and p2q2 (Ericson 5.1.9), returns their squared distance
+        float closestPointsOfSegments(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2,
+                                      glm::vec3& c1, glm::vec3& c2) {
+
+            const glm::vec3 d1 = q1 - p1;
+            const glm::vec3 d2 = q2 - p2;
+            const glm::vec3 r = p1 - p2;
+            const float a = glm::dot(d1, d1);
+            const float e = glm::dot(d2, d2);
+            const float f = glm::dot(d2, r);
+            const float epsilon = 1e-12f;
+
+            float s = 0.0f;
+            float t = 0.0f;
+            if (a <= epsilon && e <= epsilon) {
+                s = t = 0.0f;
+            }
+            else if (a <= epsilon) {
+                t = std::clamp(f / e, 0.0f, 1.0f);
+            }
+            else {
+                const float c = glm::dot(d1, r);
+                if (e <= epsilon) {
+                    s = std::clamp(-c / a, 0.0f, 1.0f);
+                }
+                else {
+                    const float b = glm::dot(d1, d2);
+                    const float denom = a * e - b * b;
+                    s = denom != 0.0f ? std::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+                    t = (b * s + f) / e;
+                    if (t < 0.0f) {
+                        t = 0.0f;
+                        s = std::clamp(-c / a, 0.0f, 1.0f);
+                    }
+                    else if (t > 1.0f) {
+                        t = 1.0f;
+                        s = std::clamp((b - c) / a, 0.0f, 1.0f);
+                    }
+                }
+            }
+
+            c1 = p1 + d1 * s;
+            c2 = p2 + d2 * t;
+            const glm::vec3 between = c1 - c2;
+            return glm::dot(between, between);
+        }
+
+        // Closest points of segment pq and triangle abc, returns their squared distance (0 when they cross)
+        float closestPointsOfSegmentTriangle(const glm::vec3& p, const glm::vec3& q,
+                                             const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+                                             glm::vec3& onSegment, glm::vec3& onTriangle) {
+
+            // the segment passing through the interior
+            const glm::vec3 direction = q - p;
+            const glm::vec3 edge1 = b - a;
+            const glm::vec3 edge2 = c - a;
+            const glm::vec3 h = glm::cross(direction, edge2);
+            const float det = glm::dot(edge1, h);
+            if (det != 0.0f) {
+                const float invDet = 1.0f / det;
+                const glm::vec3 s = p - a;
+                const float u = glm::dot(s, h) * invDet;
+                const glm::vec3 k = glm::cross(s, edge1);
+                const float v = glm::dot(direction, k) * invDet;
+                const float t = glm::dot(edge2, k) * invDet;
+                if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= 1.0f) {
+                    onSegment = onTriangle = p + direction * t;
+                    return 0.0f;
+                }
+            }
+
+            // otherwise the closest pair involves a segment end or a triangle edge
+            onSegment = p;
+            onTriangle = closestPointOnTriangle(p, a, b, c);
+            glm::vec3 between = onSegment - onTriangle;
+            float best = glm::dot(between, between);
+
+            glm::vec3 candidate = closestPointOnTriangle(q, a, b, c);
+            between = q - candidate;
+            if (glm::dot(between, between) < best) {
+                best = glm::dot(between, between);
+                onSegment = q;
+                onTriangle = candidate;
+            }
+
+            const glm::vec3 corners[4] = {a, b, c, a};
+            for (int edge = 0; edge < 3; edge++) {
+                glm::vec3 segmentPoint;
+                glm::vec3 edgePoint;
+                float distance = closestPointsOfSegments(p, q, corners[edge], corners[edge + 1], segmentPoint, edgePoint);
+                if (distance < best) {
+                    best = distance;
+                    onSegment = segmentPoint;
+                    onTriangle = edgePoint;
+                }
+            }
+            return best;
+        }
+    }
+
+    glm::vec3 CapsuleCollider::resolve(const std::vector<glm::vec3>& candidates, const Capsule& capsule, glm::vec3 position,
+                                       const glm::vec3& fallbackDirection, Stats& stats) {
+
+        const float radiusSquared = capsule.radius * capsule.radius;
+
+        // deepest contact first: pushing off one triangle of a flat wall also clears its neighbours, where
+        // handling them in turn would add the slanted push of their shared edge
+        for (int pass = 0; pass < MAX_PASSES; pass++) {
+
+            const glm::vec3 segmentStart = position + glm::vec3(0.0f, capsule.bottom, 0.0f);
+            const glm::vec3 segmentEnd = position + glm::vec3(0.0f, capsule.top, 0.0f);
+
+            size_t deepest = candidates.size();
+            float deepestSquared = radiusSquared;
+            glm::vec3 deepestOnSegment{};
+            glm::vec3 deepestOnTriangle{};
+            for (size_t i = 0; i + 2 < candidates.size(); i += 3) {
+
+                glm::vec3 onSegment;
+                glm::vec3 onTriangle;
+                float distanceSquared = closestPointsOfSegmentTriangle(segmentStart, segmentEnd, candidates[i],
+                                                                       candidates[i + 1], candidates[i + 2],
+                                                                       onSegment, onTriangle);
+                if (distanceSquared < deepestSquared) {
+                    deepest = i;
+                    deepestSquared = distanceSquared;
+                    deepestOnSegment = onSegment;
+                    deepestOnTriangle = onTriangle;
+                }
+            }
+            stats.trianglesTested += static_cast<unsigned>(candidates.size() / 3);
+
+            if (deepest == candidates.size()) {
+                break;
+            }
+
+            float distance = std::sqrt(deepestSquared);
+            glm::vec3 separation;
+            if (distance > 1e-6f) {
+                separation = (deepestOnSegment - deepestOnTriangle) / distance;
+            }
+            else {
+                // touching the surface itself: back out through the face, on the side the capsule came from
+                const glm::vec3& a = candidates[deepest];
+                glm::vec3 normal = glm::cross(candidates[deepest + 1] - a, candidates[deepest + 2] - a);
+                float normalLength = glm::length(normal);
+                if (normalLength == 0.0f) {
+                    break;
+                }
+                separation = normal / normalLength;
+                if (glm::dot(separation, fallbackDirection) < 0.0f) {
+                    separation = -separation;
+                }
+            }
+
+            position += separation * (capsule.radius * (1.0f + SKIN) - distance);
+            stats.contacts++;
+        }
+        return position;
+    }
+
+    glm::vec3 CapsuleCollider::move(const TriangleBVH& mesh, const Capsule& capsule, const glm::vec3& from,
+                                    const glm::vec3& delta, Stats* stats) {
+
+        auto start = std::chrono::steady_clock::now();
+        Stats local;
+
+        const float length = glm::length(delta);
+        const int steps = std::clamp(static_cast<int>(std::ceil(length / capsule.radius)), 1, MAX_STEPS);
+
+        // everything the sweep can reach, with another radius of slack for the push-outs
+        const glm::vec3 to = from + delta;
+        const float reach = 2.0f * capsule.radius;
+        const glm::vec3 boxMin = glm::min(from, to) + glm::vec3(-reach, capsule.bottom - reach, -reach);
+        const glm::vec3 boxMax = glm::max(from, to) + glm::vec3(reach, capsule.top + reach, reach);
+        std::vector<glm::vec3> candidates;
+        mesh.collectTriangles(boxMin, boxMax, candidates);
+
+        glm::vec3 position = from;
+        const glm::vec3 step = delta / static_cast<float>(steps);
+        for (int i = 0; i < steps; i++) {
+            position += step;
+            position = resolve(candidates, capsule, position, -step, local);
+        }
+
+        if (stats != nullptr) {
+            stats->moves++;
+            stats->steps += steps;
+            stats->trianglesTested += local.trianglesTested;
+            stats->contacts += local.contacts;
+            stats->cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        return position;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef CapsuleCollider_hpp
+#define CapsuleCollider_hpp
+
+#include "TriangleBVH.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace gps {
+
+    // Vertical capsule hanging off a position: the segment from position + (0, bottom, 0) to
+    // position + (0, top, 0), inflated by radius
+    struct Capsule {
+        float radius;
+        float bottom;
+        float top;
+    };
+
+    // Moves a capsule through a triangle mesh, sliding along whatever it touches.
+    // The sweep is split into steps of at most one radius, so the capsule never skips across a wall,
+    // and after every step it is pushed out of each triangle it overlaps along the separating direction.
+    // Only the part of the motion going into a surface is removed, the rest carries on along it.
+    class CapsuleCollider {
+
+    public:
+        // Work done by move() calls, for the frame stats
+        struct Stats {
+            unsigned moves = 0;
+            unsigned steps = 0;
+            unsigned trianglesTested = 0;
+            unsigned contacts = 0;
+            double cpuMs = 0.0;
+        };
+
+        // Where the capsule at from ends up when moved by delta, in the mesh's space
+        static glm::vec3 move(const TriangleBVH& mesh, const Capsule& capsule, const glm::vec3& from,
+                              const glm::vec3& delta, Stats* stats = nullptr);
+
+    private:
+        // Pushes the capsule at position out of the candidate triangles, a few passes at most;
+        // fallbackDirection separates a segment that passes straight through a triangle
+        static glm::vec3 resolve(const std::vector<glm::vec3>& candidates, const Capsule& capsule, glm::vec3 position,
+                                 const glm::vec3& fallbackDirection, Stats& stats);
+    };
+}
+
+#endif /* CapsuleCollider_hpp */
@@ -0,0 +1,94 @@
+#include "Frustum.hpp"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define GPS_FRUSTUM_SSE 1
+    #include <xmmintrin.h>
+#endif
+
+namespace gps {
+
+    void Frustum::extract(const glm::mat4& viewProjection, bool clipNear) {
+
+        // glm is column-major: row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        planes[0] = rows[3] + rows[0];  // left
+        planes[1] = rows[3] - rows[0];  // right
+        planes[2] = rows[3] + rows[1];  // bottom
+        planes[3] = rows[3] - rows[1];  // top
+        planes[4] = rows[3] + rows[2];  // near
+        planes[5] = rows[3] - rows[2];  // far
+
+        for (glm::vec4& plane : planes) {
+            float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            if (length > 0.0f) {
+                plane /= length;
+            }
+        }
+
+        if (!clipNear) {
+            // a plane every point lies in front of
+            planes[4] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    bool Frustum::intersects(const glm::vec3& center, const glm::vec3& extent) const {
+
+        for (const glm::vec4& plane : planes) {
+            float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+            float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+            if (distance + radius < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Frustum::cullBoxes(const float* centerX, const float* centerY, const float* centerZ,
+                            const float* extentX, const float* extentY, const float* extentZ,
+                            size_t count, uint8_t* visible) const {
+
+        size_t i = 0;
+
+#if GPS_FRUSTUM_SSE
+        // one plane against four boxes per iteration: distance + projected radius < 0 means outside
+        for (; i + 4 <= count; i += 4) {
+
+            __m128 cx = _mm_loadu_ps(centerX + i);
+            __m128 cy = _mm_loadu_ps(centerY + i);
+            __m128 cz = _mm_loadu_ps(centerZ + i);
+            __m128 ex = _mm_loadu_ps(extentX + i);
+            __m128 ey = _mm_loadu_ps(extentY + i);
+            __m128 ez = _mm_loadu_ps(extentZ + i);
+
+            __m128 outside = _mm_setzero_ps();
+            for (const glm::vec4& plane : planes) {
+
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                __m128 radius = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))),
+                    _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            visible[i + 0] = (mask & 1) ? 0 : 1;
+            visible[i + 1] = (mask & 2) ? 0 : 1;
+            visible[i + 2] = (mask & 4) ? 0 : 1;
+            visible[i + 3] = (mask & 8) ? 0 : 1;
+        }
+#endif
+
+        for (; i < count; i++) {
+            visible[i] = intersects(glm::vec3(centerX[i], centerY[i], centerZ[i]),
+                                    glm::vec3(extentX[i], extentY[i], extentZ[i])) ? 1 : 0;
+        }
+    }
+}
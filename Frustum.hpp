@@ -0,0 +1,33 @@
+#ifndef Frustum_hpp
+#define Frustum_hpp
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gps {
+
+    // Six world-space planes taken from a view-projection matrix (Gribb/Hartmann), normals pointing inwards.
+    // Boxes are tested in centre/half-extent form; a box is culled when it lies fully behind any plane.
+    class Frustum {
+
+    public:
+        // Without the near plane the volume extends indefinitely towards the eye, which is what
+        // shadow casters need: anything between the light and the ortho box still throws a shadow into it.
+        void extract(const glm::mat4& viewProjection, bool clipNear = true);
+
+        bool intersects(const glm::vec3& center, const glm::vec3& extent) const;
+
+        // Tests count boxes given as separate coordinate arrays, four per step where SSE is available.
+        // visible[i] is set to 1 when box i may intersect the frustum, 0 otherwise.
+        void cullBoxes(const float* centerX, const float* centerY, const float* centerZ,
+                       const float* extentX, const float* extentY, const float* extentZ,
+                       size_t count, uint8_t* visible) const;
+
+    private:
+        glm::vec4 planes[6];
+    };
+}
+
+#endif /* Frustum_hpp */
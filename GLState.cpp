@@ -0,0 +1,115 @@
+#include "GLState.hpp"
+
+namespace gps {
+
+    GLuint GLState::program = 0;
+    GLuint GLState::vertexArray = 0;
+    GLuint GLState::activeUnit = 0;
+    GLuint GLState::textures[GLState::TARGET_COUNT][GLState::MAX_TEXTURE_UNITS] = {};
+    int GLState::cullFace = -1;
+    bool GLState::valid = false;
+
+    GLState::Counters GLState::current;
+    GLState::Counters GLState::previous;
+
+    bool GLState::changed(bool differs) {
+
+        if (valid && !differs) {
+            current.skipped++;
+            return false;
+        }
+        current.issued++;
+        return true;
+    }
+
+    void GLState::useProgram(GLuint newProgram) {
+
+        if (changed(program != newProgram)) {
+            glUseProgram(newProgram);
+            program = newProgram;
+        }
+    }
+
+    void GLState::bindVertexArray(GLuint vao) {
+
+        if (changed(vertexArray != vao)) {
+            glBindVertexArray(vao);
+            vertexArray = vao;
+        }
+    }
+
+    void GLState::activeTexture(GLuint unit) {
+
+        if (changed(activeUnit != unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+    }
+
+    int GLState::targetSlot(GLenum target) {
+
+        switch (target) {
+            case GL_TEXTURE_CUBE_MAP:
+                return 1;
+            case GL_TEXTURE_2D_ARRAY:
+                return 2;
+            default:
+                return 0;
+        }
+    }
+
+    void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+
+        GLuint* bound = &textures[targetSlot(target)][unit];
+        if (changed(*bound != texture)) {
+            activeTexture(unit);
+            glBindTexture(target, texture);
+            *bound = texture;
+        }
+    }
+
+    void GLState::setCullFace(bool enabled) {
+
+        if (changed(cullFace != static_cast<int>(enabled))) {
+            if (enabled) {
+                glEnable(GL_CULL_FACE);
+            }
+            else {
+                glDisable(GL_CULL_FACE);
+            }
+            cullFace = enabled;
+        }
+    }
+
+    void GLState::invalidate() {
+
+        // query the few values whose real state matters, the rest is re-issued on first use
+        GLint value = 0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &value);
+        activeUnit = static_cast<GLuint>(value - GL_TEXTURE0);
+        glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+        program = static_cast<GLuint>(value);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+        vertexArray = static_cast<GLuint>(value);
+        cullFace = glIsEnabled(GL_CULL_FACE) ? 1 : 0;
+
+        for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &value);
+            textures[targetSlot(GL_TEXTURE_2D)][unit] = static_cast<GLuint>(value);
+            glGetIntegerv(GL_TEXTURE_BINDING_CUBE_MAP, &value);
+            textures[targetSlot(GL_TEXTURE_CUBE_MAP)][unit] = static_cast<GLuint>(value);
+            glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &value);
+            textures[targetSlot(GL_TEXTURE_2D_ARRAY)][unit] = static_cast<GLuint>(value);
+        }
+        glActiveTexture(GL_TEXTURE0 + activeUnit);
+
+        valid = true;
+    }
+
+    void GLState::beginFrame() {
+
+        previous = current;
+        current = Counters();
+    }
+}
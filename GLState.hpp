@@ -0,0 +1,60 @@
+#ifndef GLState_hpp
+#define GLState_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+namespace gps {
+
+    // Shadow copy of the binding state the renderer touches every frame; calls that would not
+    // change anything are skipped. Code that binds behind its back must call invalidate().
+    class GLState {
+
+    public:
+        static const int MAX_TEXTURE_UNITS = 16;
+
+        struct Counters {
+            unsigned issued = 0;
+            unsigned skipped = 0;
+            unsigned drawCalls = 0;
+        };
+
+        static void useProgram(GLuint program);
+        static void bindVertexArray(GLuint vao);
+        static void bindTexture(GLuint unit, GLenum target, GLuint texture);
+        static void setCullFace(bool enabled);
+
+        static void countDraw(unsigned calls = 1) { current.drawCalls += calls; }
+
+        // Forget everything, the next request of each kind is always issued
+        static void invalidate();
+
+        // Closes the counters of the previous frame
+        static void beginFrame();
+        static const Counters& lastFrame() { return previous; }
+
+    private:
+        static GLuint program;
+        static GLuint vertexArray;
+        static GLuint activeUnit;
+        // bindings per unit for each tracked target: 2D, cube map, 2D array
+        static const int TARGET_COUNT = 3;
+        static GLuint textures[TARGET_COUNT][MAX_TEXTURE_UNITS];
+        static int cullFace;
+        static bool valid;
+
+        static Counters current;
+        static Counters previous;
+
+        static void activeTexture(GLuint unit);
+        static int targetSlot(GLenum target);
+        static bool changed(bool differs);
+    };
+}
+
+#endif /* GLState_hpp */
@@ -0,0 +1,118 @@
+#include "GeometryBuffer.hpp"
+#include "GLState.hpp"
+
+#include <cstddef>
+#include <iostream>
+
+namespace gps {
+
+    GeometryBuffer::Registry& GeometryBuffer::registry() {
+
+        // never destroyed: the GL objects live as long as the context
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    DrawRange GeometryBuffer::append(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
+
+        Registry& reg = registry();
+
+        DrawRange range;
+        range.baseVertex = static_cast<GLint>(reg.vertexCount + reg.stagedVertices.size());
+        range.firstIndex = static_cast<GLuint>(reg.indexCount + reg.stagedIndices.size());
+        range.indexCount = static_cast<GLsizei>(indices.size());
+
+        reg.stagedVertices.insert(reg.stagedVertices.end(), vertices.begin(), vertices.end());
+        reg.stagedIndices.insert(reg.stagedIndices.end(), indices.begin(), indices.end());
+        reg.rangeCount++;
+
+        return range;
+    }
+
+    void GeometryBuffer::commit() {
+
+        Registry& reg = registry();
+        if (reg.stagedVertices.empty() && reg.stagedIndices.empty()) {
+            return;
+        }
+
+        const size_t vertexTotal = reg.vertexCount + reg.stagedVertices.size();
+        const size_t indexTotal = reg.indexCount + reg.stagedIndices.size();
+
+        GLuint newVertexBuffer = 0;
+        GLuint newIndexBuffer = 0;
+        glGenBuffers(1, &newVertexBuffer);
+        glGenBuffers(1, &newIndexBuffer);
+
+        // allocate the grown buffers, carry the committed part over without a CPU round trip
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVertexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, vertexTotal * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+        if (reg.vertexCount > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, reg.vertexBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, reg.vertexCount * sizeof(Vertex));
+        }
+        if (!reg.stagedVertices.empty()) {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, reg.vertexCount * sizeof(Vertex),
+                            reg.stagedVertices.size() * sizeof(Vertex), reg.stagedVertices.data());
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newIndexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexTotal * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+        if (reg.indexCount > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, reg.indexBuffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, reg.indexCount * sizeof(GLuint));
+        }
+        if (!reg.stagedIndices.empty()) {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, reg.indexCount * sizeof(GLuint),
+                            reg.stagedIndices.size() * sizeof(GLuint), reg.stagedIndices.data());
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &reg.vertexBuffer);
+        glDeleteBuffers(1, &reg.indexBuffer);
+        reg.vertexBuffer = newVertexBuffer;
+        reg.indexBuffer = newIndexBuffer;
+        reg.vertexCount = vertexTotal;
+        reg.indexCount = indexTotal;
+
+        std::vector<Vertex>().swap(reg.stagedVertices);
+        std::vector<GLuint>().swap(reg.stagedIndices);
+
+        setupVertexArray(reg);
+    }
+
+    void GeometryBuffer::setupVertexArray(Registry& reg) {
+
+        if (reg.vertexArray == 0) {
+            glGenVertexArrays(1, &reg.vertexArray);
+        }
+
+        // the buffers were replaced, point the attributes at the new ones
+        GLState::bindVertexArray(reg.vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, reg.vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, reg.indexBuffer);
+
+        // Vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+        // Vertex Normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
+        // Vertex Texture Coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+
+        GLState::bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void GeometryBuffer::printStats() {
+
+        const Registry& reg = registry();
+        size_t bytes = reg.vertexCount * sizeof(Vertex) + reg.indexCount * sizeof(GLuint);
+        std::cout << "Geometry buffer: " << reg.rangeCount << " meshes, " << reg.vertexCount << " vertices, "
+                  << reg.indexCount << " indices, " << bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef GeometryBuffer_hpp
+#define GeometryBuffer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "Mesh.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace gps {
+
+    // One vertex buffer, index buffer and VAO shared by every mesh in the process.
+    // Meshes append their data while loading and keep only their offsets; commit() moves
+    // everything staged so far to the GPU. GL thread only.
+    class GeometryBuffer {
+
+    public:
+        // Stages vertices/indices and returns where they will live once committed
+        static DrawRange append(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+
+        // Uploads the staged data, growing the buffers (existing contents are copied on the GPU)
+        static void commit();
+
+        static GLuint vertexArray() { return registry().vertexArray; }
+
+        static void printStats();
+
+    private:
+        struct Registry {
+            GLuint vertexArray = 0;
+            GLuint vertexBuffer = 0;
+            GLuint indexBuffer = 0;
+            // committed sizes, in elements
+            size_t vertexCount = 0;
+            size_t indexCount = 0;
+            size_t rangeCount = 0;
+            std::vector<Vertex> stagedVertices;
+            std::vector<GLuint> stagedIndices;
+        };
+
+        static Registry& registry();
+
+        static void setupVertexArray(Registry& reg);
+    };
+}
+
+#endif /* GeometryBuffer_hpp */
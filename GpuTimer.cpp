@@ -0,0 +1,67 @@
+#include "GpuTimer.hpp"
+
+namespace gps {
+
+    void GpuTimer::init() {
+
+        destroy();
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    void GpuTimer::destroy() {
+
+        if (queries[0] != 0) {
+            glDeleteQueries(QUERY_COUNT, queries);
+            for (GLuint& query : queries) {
+                query = 0;
+            }
+        }
+        issued = 0;
+        collected = 0;
+        running = false;
+    }
+
+    void GpuTimer::begin() {
+
+        if (queries[0] == 0 || running) {
+            return;
+        }
+        // every query still in flight: drop this span rather than reuse a pending one
+        if (issued - collected >= QUERY_COUNT) {
+            return;
+        }
+        glBeginQuery(GL_TIME_ELAPSED, queries[issued % QUERY_COUNT]);
+        running = true;
+    }
+
+    void GpuTimer::end() {
+
+        if (!running) {
+            return;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        running = false;
+        issued++;
+    }
+
+    bool GpuTimer::poll(double& milliseconds) {
+
+        bool found = false;
+        while (collected != issued) {
+
+            GLuint query = queries[collected % QUERY_COUNT];
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            milliseconds = static_cast<double>(nanoseconds) / 1.0e6;
+            found = true;
+            collected++;
+        }
+        return found;
+    }
+}
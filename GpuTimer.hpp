@@ -0,0 +1,41 @@
+#ifndef GpuTimer_hpp
+#define GpuTimer_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+namespace gps {
+
+    // GL_TIME_ELAPSED query around a span of GL commands. Results are read a few frames late
+    // from a ring of queries, so timing never stalls the pipeline.
+    class GpuTimer {
+
+    public:
+        // GL thread, before the first begin()
+        void init();
+        void destroy();
+
+        // Only one GL_TIME_ELAPSED query can be active at a time, spans must not nest
+        void begin();
+        void end();
+
+        // Milliseconds of the most recent span whose result has arrived; false until then
+        bool poll(double& milliseconds);
+
+    private:
+        static const int QUERY_COUNT = 4;
+
+        GLuint queries[QUERY_COUNT] = {};
+        // spans issued and spans read back, the difference is what is in flight
+        unsigned issued = 0;
+        unsigned collected = 0;
+        bool running = false;
+    };
+}
+
+#endif /* GpuTimer_hpp */
@@ -0,0 +1,121 @@
+#include "MappedFile.hpp"
+
+#if defined (_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <filesystem>
+
+namespace gps {
+
+    uint64_t hashCombine(uint64_t hash, uint64_t value) {
+
+        for (int i = 0; i < 8; i++) {
+            hash = (hash ^ ((value >> (8 * i)) & 0xffu)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t hashFileStamp(uint64_t hash, const std::string& fileName) {
+
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::file_size(fileName, ec);
+        if (ec) {
+            return hashCombine(hash, 0);
+        }
+        auto writeTime = std::filesystem::last_write_time(fileName, ec);
+        hash = hashCombine(hash, fileSize);
+        hash = hashCombine(hash, static_cast<uint64_t>(writeTime.time_since_epoch().count()));
+        return hash;
+    }
+
+    MappedFile::~MappedFile() {
+
+        close();
+    }
+
+    bool MappedFile::open(const std::string& fileName) {
+
+        close();
+
+#if defined (_WIN32)
+        HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        fileHandle = file;
+        mappingHandle = mapping;
+        mappedData = static_cast<const unsigned char*>(view);
+        mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        mappedData = static_cast<const unsigned char*>(view);
+        mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+        return true;
+    }
+
+    void MappedFile::close() {
+
+        if (mappedData == nullptr) {
+            return;
+        }
+
+#if defined (_WIN32)
+        UnmapViewOfFile(mappedData);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<unsigned char*>(mappedData), mappedSize);
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gps {
+
+    const uint64_t FINGERPRINT_SEED = 1469598103934665603ull;
+
+    // FNV-1a fold of the 8 bytes of value into hash
+    uint64_t hashCombine(uint64_t hash, uint64_t value);
+
+    // Folds a file's size and modification time into hash, used to detect stale caches
+    uint64_t hashFileStamp(uint64_t hash, const std::string& fileName);
+
+    // Read-only memory mapping of a whole file (mmap / MapViewOfFile)
+    class MappedFile {
+
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& fileName);
+        void close();
+
+        const unsigned char* data() const { return mappedData; }
+        size_t size() const { return mappedSize; }
+        bool isOpen() const { return mappedData != nullptr; }
+
+    private:
+        const unsigned char* mappedData = nullptr;
+        size_t mappedSize = 0;
+#if defined (_WIN32)
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+}
+
+#endif /* MappedFile_hpp */
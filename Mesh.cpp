@@ -1,72 +1,58 @@
 #include "Mesh.hpp"
+#include "GeometryBuffer.hpp"
+#include "GLState.hpp"
+
 namespace gps {
 
 	/* Mesh Constructor */
-	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures) {
+	Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, std::vector<Texture> textures,
+	           const BoundingBox& bounds) {
 
-		this->vertices = vertices;
-		this->indices = indices;
 		this->textures = textures;
+		this->bounds = bounds;
+
+		unitTextures.fill(0);
+		for (const Texture& texture : this->textures) {
+			if (texture.type == "ambientTexture") {
+				unitTextures[AMBIENT_TEXTURE_UNIT] = texture.id;
+			}
+			else if (texture.type == "diffuseTexture") {
+				unitTextures[DIFFUSE_TEXTURE_UNIT] = texture.id;
+			}
+			else if (texture.type == "specularTexture") {
+				unitTextures[SPECULAR_TEXTURE_UNIT] = texture.id;
+			}
+		}
 
-		this->setupMesh();
-	}
-
-	Buffers Mesh::getBuffers() {
-	    return this->buffers;
+		this->range = GeometryBuffer::append(vertices, indices);
 	}
 
-	/* Mesh drawing function - also applies associated textures */
-	void Mesh::Draw(gps::Shader shader)	{
+	void Mesh::bindSamplerUnits(const gps::Shader& shader) {
 
 		shader.useShaderProgram();
+		glUniform1i(shader.getUniformLocation("ambientTexture"), AMBIENT_TEXTURE_UNIT);
+		glUniform1i(shader.getUniformLocation("diffuseTexture"), DIFFUSE_TEXTURE_UNIT);
+		glUniform1i(shader.getUniformLocation("specularTexture"), SPECULAR_TEXTURE_UNIT);
+	}
 
-		//set textures
-		for (GLuint i = 0; i < textures.size(); i++) {
-
-			glActiveTexture(GL_TEXTURE0 + i);
-			glUniform1i(glGetUniformLocation(shader.shaderProgram, this->textures[i].type.c_str()), i);
-			glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
-		}
-
-		glBindVertexArray(this->buffers.VAO);
-		glDrawElements(GL_TRIANGLES, (GLsizei)this->indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
-        for(GLuint i = 0; i < this->textures.size(); i++) {
-
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
-
-    }
-
-	// Initializes all the buffer objects/arrays
-	void Mesh::setupMesh() {
+	void Mesh::bindTextures() const {
 
-		// Create buffers/arrays
-		glGenVertexArrays(1, &this->buffers.VAO);
-		glGenBuffers(1, &this->buffers.VBO);
-		glGenBuffers(1, &this->buffers.EBO);
+		//units are fixed, so consecutive meshes sharing a texture bind nothing
+		for (GLuint unit = 0; unit < TEXTURE_UNIT_COUNT; unit++) {
 
-		glBindVertexArray(this->buffers.VAO);
-		// Load data into vertex buffers
-		glBindBuffer(GL_ARRAY_BUFFER, this->buffers.VBO);
-		glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+			GLState::bindTexture(unit, GL_TEXTURE_2D, unitTextures[unit]);
+		}
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->buffers.EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(GLuint), &this->indices[0], GL_STATIC_DRAW);
+	/* Mesh drawing function - also applies associated textures */
+	void Mesh::Draw(const gps::Shader& shader) {
 
-		// Set the vertex attribute pointers
-		// Vertex Positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-		// Vertex Normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, Normal));
-		// Vertex Texture Coords
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, TexCoords));
+		shader.useShaderProgram();
+		bindTextures();
 
-		glBindVertexArray(0);
+		GLState::bindVertexArray(GeometryBuffer::vertexArray());
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+		                         (GLvoid*)(range.firstIndex * sizeof(GLuint)), range.baseVertex);
+		GLState::countDraw();
 	}
 }
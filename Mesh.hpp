@@ -13,6 +13,7 @@
 
 #include "Shader.hpp"
 
+#include <array>
 #include <string>
 #include <vector>
 
@@ -41,32 +42,53 @@ namespace gps {
         glm::vec3 specular;
     };
 
-    struct Buffers {
-        GLuint VAO;
-        GLuint VBO;
-        GLuint EBO;
+    // Axis-aligned box in the space of the vertices it encloses
+    struct BoundingBox {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // Where a mesh lives inside the shared GeometryBuffer
+    struct DrawRange {
+        GLint baseVertex;
+        GLuint firstIndex;
+        GLsizei indexCount;
     };
 
     class Mesh {
 
     public:
-        std::vector<Vertex> vertices;
-        std::vector<GLuint> indices;
         std::vector<Texture> textures;
 
-	    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
+	    // Fixed texture units per texture type; point the program's samplers at them once after linking
+	    static const GLuint AMBIENT_TEXTURE_UNIT = 0;
+	    static const GLuint DIFFUSE_TEXTURE_UNIT = 1;
+	    static const GLuint SPECULAR_TEXTURE_UNIT = 2;
+	    static const GLuint TEXTURE_UNIT_COUNT = 3;
+	    using TextureSet = std::array<GLuint, TEXTURE_UNIT_COUNT>;
 
-	    Buffers getBuffers();
+	    // The geometry is staged in the GeometryBuffer, it is drawable once that is committed
+	    Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, std::vector<Texture> textures,
+	         const BoundingBox& bounds);
 
-	    void Draw(gps::Shader shader);
+	    const DrawRange& getDrawRange() const { return range; }
+	    // Model-space bounds, used for culling
+	    const BoundingBox& getBounds() const { return bounds; }
+	    // Texture bound to each fixed unit, 0 where the mesh has no texture of that type
+	    const TextureSet& getTextureSet() const { return unitTextures; }
 
-    private:
-        /*  Render data  */
-        Buffers buffers;
+	    // Binds this mesh's textures to their units (the shared VAO is bound by the caller)
+	    void bindTextures() const;
 
-	    // Initializes all the buffer objects/arrays
-	    void setupMesh();
+	    void Draw(const gps::Shader& shader);
 
+	    static void bindSamplerUnits(const gps::Shader& shader);
+
+    private:
+        /*  Render data  */
+        DrawRange range;
+        BoundingBox bounds;
+        TextureSet unitTextures;
     };
 
 }
@@ -0,0 +1,228 @@
+#include "MeshCache.hpp"
+#include "MappedFile.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace gps {
+
+    namespace {
+
+        const char CACHE_MAGIC[8] = {'G', 'P', 'S', 'M', 'E', 'S', 'H', '\0'};
+
+        static_assert(sizeof(gps::Vertex) == 8 * sizeof(float), "mesh cache stores Vertex as 8 packed floats");
+        struct CacheHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t meshCount;
+            uint64_t fingerprint;
+            float boundsMin[3];
+            float boundsMax[3];
+            uint32_t reserved[2];
+        };
+
+        struct MeshHeader {
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint32_t textureCount;
+            uint32_t reserved;
+            float boundsMin[3];
+            float boundsMax[3];
+        };
+
+        // Bounds-checked reader over the mapped file
+        struct Cursor {
+            const unsigned char* data;
+            size_t size;
+            size_t offset;
+
+            bool read(void* dst, size_t bytes) {
+                if (bytes > size - offset) {
+                    return false;
+                }
+                if (bytes > 0) {
+                    std::memcpy(dst, data + offset, bytes);
+                }
+                offset += bytes;
+                return true;
+            }
+
+            bool readString(std::string& dst, uint32_t length) {
+                if (length > size - offset) {
+                    return false;
+                }
+                dst.assign(reinterpret_cast<const char*>(data + offset), length);
+                offset += length;
+                return skipPadding();
+            }
+
+            bool skipPadding() {
+                size_t aligned = (offset + 3) & ~static_cast<size_t>(3);
+                if (aligned > size) {
+                    return false;
+                }
+                offset = aligned;
+                return true;
+            }
+        };
+
+        void writeString(std::ofstream& out, const std::string& value) {
+            out.write(value.data(), static_cast<std::streamsize>(value.size()));
+            const char padding[4] = {0, 0, 0, 0};
+            out.write(padding, static_cast<std::streamsize>((4 - value.size() % 4) % 4));
+        }
+    }
+
+    std::string MeshCache::cachePathFor(const std::string& objFileName) {
+
+        std::filesystem::path path(objFileName);
+        path.replace_extension(".meshcache");
+        return path.string();
+    }
+
+    uint64_t MeshCache::fingerprint(const std::string& objFileName) {
+
+        std::filesystem::path objPath(objFileName);
+        std::filesystem::path mtlPath = objPath;
+        mtlPath.replace_extension(".mtl");
+
+        uint64_t hash = FINGERPRINT_SEED;
+        hash = hashCombine(hash, FORMAT_VERSION);
+        hash = hashFileStamp(hash, objPath.string());
+        hash = hashFileStamp(hash, mtlPath.string());
+        return hash;
+    }
+
+    bool MeshCache::load(const std::string& cacheFileName, uint64_t fingerprint, Model3D::ModelData& data) {
+
+        if (!readEnabled) {
+            return false;
+        }
+
+        MappedFile file;
+        if (!file.open(cacheFileName)) {
+            return false;
+        }
+
+        Cursor cursor{file.data(), file.size(), 0};
+
+        CacheHeader header;
+        if (!cursor.read(&header, sizeof(header)) ||
+            std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+            header.version != FORMAT_VERSION ||
+            header.fingerprint != fingerprint) {
+            return false;
+        }
+
+        Model3D::ModelData result;
+        result.bounds.min = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        result.bounds.max = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        result.meshes.resize(header.meshCount);
+
+        for (auto& mesh : result.meshes) {
+
+            MeshHeader meshHeader;
+            if (!cursor.read(&meshHeader, sizeof(meshHeader))) {
+                return false;
+            }
+
+            // reject counts that cannot fit in the file before allocating for them
+            if (meshHeader.vertexCount > (file.size() - cursor.offset) / sizeof(gps::Vertex) ||
+                meshHeader.indexCount > (file.size() - cursor.offset) / sizeof(GLuint)) {
+                return false;
+            }
+
+            mesh.bounds.min = glm::vec3(meshHeader.boundsMin[0], meshHeader.boundsMin[1], meshHeader.boundsMin[2]);
+            mesh.bounds.max = glm::vec3(meshHeader.boundsMax[0], meshHeader.boundsMax[1], meshHeader.boundsMax[2]);
+            mesh.vertices.resize(meshHeader.vertexCount);
+            mesh.indices.resize(meshHeader.indexCount);
+            if (!cursor.read(mesh.vertices.data(), mesh.vertices.size() * sizeof(gps::Vertex)) ||
+                !cursor.read(mesh.indices.data(), mesh.indices.size() * sizeof(GLuint))) {
+                return false;
+            }
+
+            for (GLuint index : mesh.indices) {
+                if (index >= meshHeader.vertexCount) {
+                    return false;
+                }
+            }
+
+            mesh.textures.resize(meshHeader.textureCount);
+            for (auto& texture : mesh.textures) {
+
+                uint32_t lengths[2];
+                if (!cursor.read(lengths, sizeof(lengths)) ||
+                    !cursor.readString(texture.type, lengths[0]) ||
+                    !cursor.readString(texture.path, lengths[1])) {
+                    return false;
+                }
+                texture.id = 0;
+            }
+        }
+
+        data = std::move(result);
+        return true;
+    }
+
+    bool MeshCache::save(const std::string& cacheFileName, uint64_t fingerprint, const Model3D::ModelData& data) {
+
+        // write to a temporary file first so a crash never leaves a truncated cache behind
+        std::string tempFileName = cacheFileName + ".tmp";
+        {
+            std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                return false;
+            }
+
+            CacheHeader header{};
+            std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            header.version = FORMAT_VERSION;
+            header.meshCount = static_cast<uint32_t>(data.meshes.size());
+            header.fingerprint = fingerprint;
+            for (int i = 0; i < 3; i++) {
+                header.boundsMin[i] = data.bounds.min[i];
+                header.boundsMax[i] = data.bounds.max[i];
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            for (const auto& mesh : data.meshes) {
+
+                MeshHeader meshHeader{};
+                meshHeader.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+                meshHeader.indexCount = static_cast<uint32_t>(mesh.indices.size());
+                meshHeader.textureCount = static_cast<uint32_t>(mesh.textures.size());
+                for (int i = 0; i < 3; i++) {
+                    meshHeader.boundsMin[i] = mesh.bounds.min[i];
+                    meshHeader.boundsMax[i] = mesh.bounds.max[i];
+                }
+                out.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+                out.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+                          static_cast<std::streamsize>(mesh.vertices.size() * sizeof(gps::Vertex)));
+                out.write(reinterpret_cast<const char*>(mesh.indices.data()),
+                          static_cast<std::streamsize>(mesh.indices.size() * sizeof(GLuint)));
+
+                for (const auto& texture : mesh.textures) {
+
+                    uint32_t lengths[2] = {static_cast<uint32_t>(texture.type.size()),
+                                           static_cast<uint32_t>(texture.path.size())};
+                    out.write(reinterpret_cast<const char*>(lengths), sizeof(lengths));
+                    writeString(out, texture.type);
+                    writeString(out, texture.path);
+                }
+            }
+
+            if (!out) {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempFileName, cacheFileName, ec);
+        if (ec) {
+            std::filesystem::remove(tempFileName, ec);
+            return false;
+        }
+        return true;
+    }
+}
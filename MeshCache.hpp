@@ -0,0 +1,35 @@
+#ifndef MeshCache_hpp
+#define MeshCache_hpp
+
+#include "Model3D.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace gps {
+
+    // Versioned binary snapshot of a parsed model, stored next to its .obj.
+    // A cache file is only used when its fingerprint matches the current .obj/.mtl.
+    class MeshCache {
+
+    public:
+        // Bump whenever the file layout or the contents of ModelData change
+        static const uint32_t FORMAT_VERSION = 4;
+
+        static std::string cachePathFor(const std::string& objFileName);
+
+        // Hash of the source .obj and its sibling .mtl (size and modification time)
+        static uint64_t fingerprint(const std::string& objFileName);
+
+        static bool load(const std::string& cacheFileName, uint64_t fingerprint, Model3D::ModelData& data);
+        static bool save(const std::string& cacheFileName, uint64_t fingerprint, const Model3D::ModelData& data);
+
+        // When disabled, existing caches are ignored (but still rewritten), to measure a cold start
+        static void setReadEnabled(bool enabled) { readEnabled = enabled; }
+
+    private:
+        static inline bool readEnabled = true;
+    };
+}
+
+#endif /* MeshCache_hpp */
@@ -1,33 +1,175 @@
 #include "Model3D.hpp"
+#include "MeshCache.hpp"
+#include "GeometryBuffer.hpp"
+#include "GLState.hpp"
+#include "ThreadPool.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 
 namespace gps {
 
+    namespace {
+
+        // Hash/equality on the full (position, normal, texcoord) tuple so that
+        // face corners sharing all three attributes collapse into one vertex
+        struct VertexKeyHash {
+            size_t operator()(const gps::Vertex& v) const {
+                const float values[8] = {
+                    v.Position.x, v.Position.y, v.Position.z,
+                    v.Normal.x, v.Normal.y, v.Normal.z,
+                    v.TexCoords.x, v.TexCoords.y
+                };
+                size_t hash = 1469598103934665603ull;
+                for (float value : values) {
+                    // fold -0.0f onto 0.0f so equal keys always hash equally
+                    value += 0.0f;
+                    uint32_t bits;
+                    std::memcpy(&bits, &value, sizeof(bits));
+                    hash = (hash ^ bits) * 1099511628211ull;
+                }
+                return hash;
+            }
+        };
+
+        struct VertexKeyEqual {
+            bool operator()(const gps::Vertex& a, const gps::Vertex& b) const {
+                return a.Position == b.Position && a.Normal == b.Normal && a.TexCoords == b.TexCoords;
+            }
+        };
+    }
+
 	void Model3D::LoadModel(std::string fileName) {
 
         std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
-		ReadOBJ(fileName, basePath);
+		LoadModel(fileName, basePath);
 	}
 
     void Model3D::LoadModel(std::string fileName, std::string basePath)	{
 
-		ReadOBJ(fileName, basePath);
+		Prepare(fileName, basePath);
+		BuildQueryData();
+		FinishLoading({});
+		GeometryBuffer::commit();
 	}
 
+    void Model3D::Prepare(std::string fileName) {
+
+        std::string basePath = fileName.substr(0, fileName.find_last_of('/')) + "/";
+        Prepare(fileName, basePath);
+    }
+
+    // CPU half of loading: only touches this model's pending data and its cache file
+    void Model3D::Prepare(std::string fileName, std::string basePath) {
+
+        pendingData = ModelData();
+        sourceFile = fileName;
+        std::string cachePath = MeshCache::cachePathFor(fileName);
+        uint64_t fingerprint = MeshCache::fingerprint(fileName);
+
+        if (MeshCache::load(cachePath, fingerprint, pendingData)) {
+
+            std::cout << "Loading : " << fileName << " (mesh cache)\n";
+        }
+        else {
+
+            ReadOBJ(fileName, basePath, pendingData);
+            if (!MeshCache::save(cachePath, fingerprint, pendingData)) {
+
+                std::cerr << "WARNING: could not write mesh cache " << cachePath << std::endl;
+            }
+        }
+    }
+
+    std::vector<std::string> Model3D::GetTexturePaths() const {
+
+        std::vector<std::string> paths;
+        for (const auto& mesh : pendingData.meshes) {
+
+            for (const auto& texture : mesh.textures) {
+
+                if (std::find(paths.begin(), paths.end(), texture.path) == paths.end()) {
+
+                    paths.push_back(texture.path);
+                }
+            }
+        }
+        return paths;
+    }
+
+    // GL half of loading: must run on the context thread
+    void Model3D::FinishLoading(const TextureCache::DecodedImageMap& images) {
+
+        Upload(pendingData, images);
+        pendingData = ModelData();
+    }
+
 	// Draw each mesh from the model
-	void Model3D::Draw(gps::Shader shaderProgram) {
+	void Model3D::Draw(const gps::Shader& shaderProgram) {
+
+		shaderProgram.useShaderProgram();
 
-		for (int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shaderProgram);
+		for (size_t i = 0; i < batches.size(); i++)
+			DrawBatch(i, true);
+	}
+
+	void Model3D::DrawBatch(size_t batchIndex, bool bindTextures, const uint8_t* meshVisible) const {
+
+		const MeshBatch& batch = batches[batchIndex];
+		const GLsizei* counts = batch.counts.data();
+		const GLvoid* const* offsets = batch.offsets.data();
+		const GLint* baseVertices = batch.baseVertices.data();
+		GLsizei drawCount = (GLsizei)batch.counts.size();
+
+		// compact the visible meshes of the batch into scratch arrays (GL thread only)
+		static std::vector<GLsizei> visibleCounts;
+		static std::vector<const GLvoid*> visibleOffsets;
+		static std::vector<GLint> visibleBaseVertices;
+		if (meshVisible != nullptr) {
+
+			visibleCounts.clear();
+			visibleOffsets.clear();
+			visibleBaseVertices.clear();
+			for (size_t i = 0; i < batch.counts.size(); i++) {
+
+				if (meshVisible[batch.firstMesh + i]) {
+					visibleCounts.push_back(batch.counts[i]);
+					visibleOffsets.push_back(batch.offsets[i]);
+					visibleBaseVertices.push_back(batch.baseVertices[i]);
+				}
+			}
+			if (visibleCounts.empty()) {
+				return;
+			}
+			counts = visibleCounts.data();
+			offsets = visibleOffsets.data();
+			baseVertices = visibleBaseVertices.data();
+			drawCount = (GLsizei)visibleCounts.size();
+		}
+
+		if (bindTextures) {
+			meshes[batch.firstMesh].bindTextures();
+		}
+
+		GLState::bindVertexArray(GeometryBuffer::vertexArray());
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, drawCount,
+		                              const_cast<GLint*>(baseVertices));
+		GLState::countDraw();
 	}
 
 	// Does the parsing of the .obj file and fills in the data structure
-	void Model3D::ReadOBJ(std::string fileName, std::string basePath) {
+	void Model3D::ReadOBJ(std::string fileName, std::string basePath, ModelData& data) {
 
-        std::cout << "Loading : " << fileName << std::endl;
+		// collected and printed at once, models may be parsed on several threads
+		std::ostringstream report;
+		report << "Loading : " << fileName << "\n";
 		tinyobj::attrib_t attrib;
 		std::vector<tinyobj::shape_t> shapes;
 		std::vector<tinyobj::material_t> materials;
@@ -44,21 +186,31 @@ namespace gps {
 
 		if (!ret) {
 
-			exit(1);
+			// may be on a worker: the caller reports it on the main thread
+			throw std::runtime_error("Could not load model " + fileName + "!");
 		}
 
-		std::cout << "# of shapes    : " << shapes.size() << std::endl;
-		std::cout << "# of materials : " << materials.size() << std::endl;
+		report << "# of shapes    : " << shapes.size() << "\n";
+		report << "# of materials : " << materials.size() << "\n";
 
         glm::vec3 minBounds(std::numeric_limits<float>::max());
         glm::vec3 maxBounds(std::numeric_limits<float>::lowest());
 
+        size_t faceCornerCount = 0;
+        size_t uniqueVertexCount = 0;
+
 		// Loop over shapes
 		for (size_t s = 0; s < shapes.size(); s++) {
 
 			std::vector<gps::Vertex> vertices;
 			std::vector<GLuint> indices;
 			std::vector<gps::Texture> textures;
+			AABB meshBounds{glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+
+			// Welds identical face corners so the index buffer actually shares vertices
+			std::unordered_map<gps::Vertex, GLuint, VertexKeyHash, VertexKeyEqual> uniqueVertices;
+			uniqueVertices.reserve(shapes[s].mesh.indices.size());
+			indices.reserve(shapes[s].mesh.indices.size());
 
 			// Loop over faces(polygon)
 			size_t index_offset = 0;
@@ -87,7 +239,8 @@ namespace gps {
 					if (idx.texcoord_index != -1) {
 
 						tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-						ty = attrib.texcoords[2 * idx.texcoord_index + 1];
+						// images are uploaded top row first, flip v here instead of flipping every image
+						ty = 1.0f - attrib.texcoords[2 * idx.texcoord_index + 1];
 					}
 
 					glm::vec3 vertexPosition(vx, vy, vz);
@@ -101,15 +254,24 @@ namespace gps {
 
                     minBounds = glm::min(minBounds, vertexPosition);
                     maxBounds = glm::max(maxBounds, vertexPosition);
+                    meshBounds.min = glm::min(meshBounds.min, vertexPosition);
+                    meshBounds.max = glm::max(meshBounds.max, vertexPosition);
+
+					auto inserted = uniqueVertices.emplace(currentVertex, (GLuint)vertices.size());
+					if (inserted.second) {
 
-					vertices.push_back(currentVertex);
+						vertices.push_back(currentVertex);
+					}
 
-					indices.push_back((GLuint)(index_offset + v));
+					indices.push_back(inserted.first->second);
 				}
 
 				index_offset += fv;
 			}
 
+			faceCornerCount += indices.size();
+			uniqueVertexCount += vertices.size();
+
 			// get material id
 			// Only try to read materials if the .mtl file is present
 			size_t a = shapes[s].mesh.material_ids.size();
@@ -130,7 +292,9 @@ namespace gps {
 					if (!ambientTexturePath.empty()) {
 
 						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + ambientTexturePath, "ambientTexture");
+						currentTexture.id = 0;
+						currentTexture.type = "ambientTexture";
+						currentTexture.path = basePath + ambientTexturePath;
 						textures.push_back(currentTexture);
 					}
 
@@ -140,7 +304,9 @@ namespace gps {
 					if (!diffuseTexturePath.empty()) {
 
 						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + diffuseTexturePath, "diffuseTexture");
+						currentTexture.id = 0;
+						currentTexture.type = "diffuseTexture";
+						currentTexture.path = basePath + diffuseTexturePath;
 						textures.push_back(currentTexture);
 					}
 
@@ -150,251 +316,215 @@ namespace gps {
 					if (!specularTexturePath.empty()) {
 
 						gps::Texture currentTexture;
-						currentTexture = LoadTexture(basePath + specularTexturePath, "specularTexture");
+						currentTexture.id = 0;
+						currentTexture.type = "specularTexture";
+						currentTexture.path = basePath + specularTexturePath;
 						textures.push_back(currentTexture);
 					}
 				}
 			}
 
-			meshes.push_back(gps::Mesh(vertices, indices, textures));
+			data.meshes.push_back({vertices, indices, textures, meshBounds});
 		}
 
-        modelBounds.min = minBounds;
-        modelBounds.max = maxBounds;
-        boundsValid = true;
+		report << "# of vertices  : " << faceCornerCount << " -> " << uniqueVertexCount << " after welding";
+		if (uniqueVertexCount > 0) {
+
+			report << " (" << static_cast<float>(faceCornerCount) / static_cast<float>(uniqueVertexCount) << "x)";
+		}
+		report << "\n";
+		std::cout << report.str();
 
-        const float normalThreshold = 0.6f;
-        walkTriangles.clear();
+        data.bounds.min = minBounds;
+        data.bounds.max = maxBounds;
+	}
 
-        for (const auto& mesh : meshes)
-        {
-            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
-            {
-                const glm::vec3 v0 = mesh.vertices[mesh.indices[i]].Position;
-                const glm::vec3 v1 = mesh.vertices[mesh.indices[i + 1]].Position;
-                const glm::vec3 v2 = mesh.vertices[mesh.indices[i + 2]].Position;
-
-                const glm::vec3 n = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-                if (n.y < normalThreshold)
-                {
-                    continue;
-                }
+    // Creates the GPU meshes and textures from the CPU-side model data
+    void Model3D::Upload(const ModelData& data, const TextureCache::DecodedImageMap& images) {
 
-                walkTriangles.push_back({v0, v1, v2});
-            }
-        }
+        for (const auto& meshData : data.meshes) {
 
-        walkGridOrigin = glm::vec2(modelBounds.min.x, modelBounds.min.z);
-        walkGridWidth = static_cast<int>(std::ceil((modelBounds.max.x - modelBounds.min.x) / walkCellSize)) + 1;
-        walkGridHeight = static_cast<int>(std::ceil((modelBounds.max.z - modelBounds.min.z) / walkCellSize)) + 1;
-        walkGrid.assign(walkGridWidth * walkGridHeight, {});
+            std::vector<gps::Texture> textures;
+            for (const auto& textureRef : meshData.textures) {
 
-        for (size_t t = 0; t < walkTriangles.size(); ++t)
-        {
-            const auto& tri = walkTriangles[t];
-            const float minX = std::min({tri.v0.x, tri.v1.x, tri.v2.x});
-            const float maxX = std::max({tri.v0.x, tri.v1.x, tri.v2.x});
-            const float minZ = std::min({tri.v0.z, tri.v1.z, tri.v2.z});
-            const float maxZ = std::max({tri.v0.z, tri.v1.z, tri.v2.z});
-
-            int ix0 = static_cast<int>(std::floor((minX - walkGridOrigin.x) / walkCellSize));
-            int ix1 = static_cast<int>(std::floor((maxX - walkGridOrigin.x) / walkCellSize));
-            int iz0 = static_cast<int>(std::floor((minZ - walkGridOrigin.y) / walkCellSize));
-            int iz1 = static_cast<int>(std::floor((maxZ - walkGridOrigin.y) / walkCellSize));
-
-            ix0 = std::clamp(ix0, 0, walkGridWidth - 1);
-            ix1 = std::clamp(ix1, 0, walkGridWidth - 1);
-            iz0 = std::clamp(iz0, 0, walkGridHeight - 1);
-            iz1 = std::clamp(iz1, 0, walkGridHeight - 1);
-
-            for (int iz = iz0; iz <= iz1; ++iz)
-            {
-                for (int ix = ix0; ix <= ix1; ++ix)
-                {
-                    walkGrid[iz * walkGridWidth + ix].push_back(static_cast<int>(t));
-                }
+                textures.push_back(LoadTexture(textureRef.path, textureRef.type, images));
             }
+
+            meshes.push_back(gps::Mesh(meshData.vertices, meshData.indices, textures, meshData.bounds));
         }
+        BuildBatches();
 
-        walkGridValid = true;
+        modelBounds = data.bounds;
+        boundsValid = true;
+    }
 
-	}
+    void Model3D::BuildBatches() {
+
+        // draw order inside a model does not matter (opaque), so gather meshes that bind the same textures
+        std::stable_sort(meshes.begin(), meshes.end(), [](const gps::Mesh& a, const gps::Mesh& b) {
+            return a.getTextureSet() < b.getTextureSet();
+        });
+
+        batches.clear();
+        for (size_t i = 0; i < meshes.size(); i++) {
+
+            if (batches.empty() || meshes[batches.back().firstMesh].getTextureSet() != meshes[i].getTextureSet()) {
+
+                batches.push_back(MeshBatch{i, {}, {}, {}});
+            }
+
+            const DrawRange& range = meshes[i].getDrawRange();
+            MeshBatch& batch = batches.back();
+            batch.counts.push_back(range.indexCount);
+            batch.offsets.push_back((const GLvoid*)(range.firstIndex * sizeof(GLuint)));
+            batch.baseVertices.push_back(range.baseVertex);
+        }
+    }
 
     bool Model3D::getHeightAt(float x, float z, float currentY, float& outHeight) const
     {
-        if (!walkGridValid || walkGridWidth == 0 || walkGridHeight == 0)
-        {
-            return false;
-        }
+        return walkGrid.getHeightAt(x, z, currentY, outHeight);
+    }
+
+    void Model3D::StartQueryData(ThreadPool& pool)
+    {
+        QueueQueryData(&pool);
+    }
 
-        int ix = static_cast<int>(std::floor((x - walkGridOrigin.x) / walkCellSize));
-        int iz = static_cast<int>(std::floor((z - walkGridOrigin.y) / walkCellSize));
+    void Model3D::BuildQueryData()
+    {
+        QueueQueryData(nullptr);
+        FinishQueryData();
+    }
 
-        if (ix < 0 || ix >= walkGridWidth || iz < 0 || iz >= walkGridHeight)
+    void Model3D::QueueQueryData(ThreadPool* pool)
+    {
+        if (!walkable && !pickable)
         {
-            return false;
+            return;
         }
 
-        const float eps = 1e-4f;
-        float bestDiff = std::numeric_limits<float>::max();
-        bool found = false;
-
-        for (int dz = -1; dz <= 1; ++dz)
+        // shared by both builds, which may still be running after FinishLoading has dropped pendingData
+        auto vertices = std::make_shared<std::vector<glm::vec3>>();
+        for (const auto& mesh : pendingData.meshes)
         {
-            for (int dx = -1; dx <= 1; ++dx)
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
             {
-                int cx = ix + dx;
-                int cz = iz + dz;
-                if (cx < 0 || cx >= walkGridWidth || cz < 0 || cz >= walkGridHeight)
-                {
-                    continue;
-                }
-
-                const auto& cell = walkGrid[cz * walkGridWidth + cx];
-                for (int triIndex : cell)
-                {
-                    const auto& tri = walkTriangles[triIndex];
-                    const glm::vec2 a(tri.v0.x, tri.v0.z);
-                    const glm::vec2 b(tri.v1.x, tri.v1.z);
-                    const glm::vec2 c(tri.v2.x, tri.v2.z);
-                    const glm::vec2 p(x, z);
-
-                    const glm::vec2 v0 = b - a;
-                    const glm::vec2 v1 = c - a;
-                    const glm::vec2 v2 = p - a;
-
-                    float denom = v0.x * v1.y - v1.x * v0.y;
-                    if (std::abs(denom) < eps)
-                    {
-                        continue;
-                    }
-
-                    float v = (v2.x * v1.y - v1.x * v2.y) / denom;
-                    float w = (v0.x * v2.y - v2.x * v0.y) / denom;
-                    float u = 1.0f - v - w;
-
-                    if (u < -eps || v < -eps || w < -eps)
-                    {
-                        continue;
-                    }
-
-                    float y = u * tri.v0.y + v * tri.v1.y + w * tri.v2.y;
-                    float diff = std::abs(y - currentY);
-                    if (diff < bestDiff)
-                    {
-                        bestDiff = diff;
-                        outHeight = y;
-                        found = true;
-                    }
-                }
+                vertices->push_back(mesh.vertices[mesh.indices[i]].Position);
+                vertices->push_back(mesh.vertices[mesh.indices[i + 1]].Position);
+                vertices->push_back(mesh.vertices[mesh.indices[i + 2]].Position);
             }
         }
+        if (walkable)
+        {
+            walkGridVertices = vertices;
+            walkGridBounds = pendingData.bounds;
+        }
 
-        return found;
+        auto buildBVH = [this, vertices]() {
+            auto start = std::chrono::steady_clock::now();
+            triangleBVH.build(*vertices);
+            triangleBVHBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        if (pool != nullptr)
+        {
+            queryJobs.push_back(pool->submit(buildBVH));
+        }
+        else
+        {
+            buildBVH();
+        }
     }
 
+    // The chunk jobs of a pooled build are waited on here, which is why this can't run on a worker
+    void Model3D::BuildWalkGrid(ThreadPool* pool)
+    {
+        if (!walkGridVertices)
+        {
+            return;
+        }
 
-	// Retrieves a texture associated with the object - by its name and type
-	gps::Texture Model3D::LoadTexture(std::string path, std::string type) {
-
-			for (int i = 0; i < loadedTextures.size(); i++) {
-
-				if (loadedTextures[i].path == path)	{
-
-					//already loaded texture
-					return loadedTextures[i];
-				}
-			}
+        // faces at most ~53 degrees off horizontal count as floor
+        const float minFloorNormalY = 0.6f;
+        const float walkCellSize = 0.5f;
+        auto start = std::chrono::steady_clock::now();
+        walkGrid.build(*walkGridVertices, minFloorNormalY, walkGridBounds.min, walkGridBounds.max, walkCellSize, pool);
+        walkGridBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        walkGridWorkers = pool != nullptr ? pool->size() : 1;
+        walkGridVertices.reset();
+    }
 
-			gps::Texture currentTexture;
-			currentTexture.id = ReadTextureFromFile(path.c_str());
-			currentTexture.type = std::string(type);
-			currentTexture.path = path;
+    void Model3D::FinishQueryData()
+    {
+        if (!walkable && !pickable)
+        {
+            return;
+        }
 
-			loadedTextures.push_back(currentTexture);
+        // a caller without a pool at hand gets the walk grid built here, inline
+        BuildWalkGrid(nullptr);
+        for (auto& job : queryJobs)
+        {
+            job.get();
+        }
+        queryJobs.clear();
 
-			return currentTexture;
-		}
+        std::ostringstream report;
+        report << "Query data     : " << sourceFile << "\n";
+        if (walkable)
+        {
+            report << "  walk grid    : " << walkGrid.getTriangleCount() << " floor triangles, "
+                   << walkGrid.getEntryCount() << " cell entries in " << walkGridBuildMs << " ms on "
+                   << walkGridWorkers << (walkGridWorkers == 1 ? " thread\n" : " threads\n");
+        }
+        report << "  triangle BVH : " << triangleBVH.getTriangleCount() << " triangles, " << triangleBVH.getNodeCount()
+               << " nodes in " << triangleBVHBuildMs << " ms\n";
+        std::cout << report.str();
+    }
 
-	// Reads the pixel data from an image file and loads it into the video memory
-	GLuint Model3D::ReadTextureFromFile(const char* file_name) {
+    bool Model3D::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const
+    {
+        return triangleBVH.raycast(origin, direction, maxDistance, hit);
+    }
 
-		int x, y, n;
-		int force_channels = 4;
-		unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
+    bool Model3D::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+    {
+        return triangleBVH.occluded(origin, direction, maxDistance);
+    }
 
-		if (!image_data) {
-			fprintf(stderr, "ERROR: could not load %s\n", file_name);
-			return false;
-		}
-		// NPOT check
-		if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
-			fprintf(
-				stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
-			);
-		}
+    glm::vec3 Model3D::moveCapsule(const Capsule& capsule, const glm::vec3& from, const glm::vec3& delta,
+                                   CapsuleCollider::Stats* stats) const
+    {
+        return CapsuleCollider::move(triangleBVH, capsule, from, delta, stats);
+    }
 
-		int width_in_bytes = x * 4;
-		unsigned char *top = NULL;
-		unsigned char *bottom = NULL;
-		unsigned char temp = 0;
-		int half_height = y / 2;
+    void Model3D::getHeightsAt(std::span<const glm::vec3> points, std::span<float> outHeights, std::span<uint8_t> outHits,
+                               ThreadPool* pool) const
+    {
+        walkGrid.getHeightsAt(points, outHeights, outHits, pool);
+    }
 
-		for (int row = 0; row < half_height; row++) {
 
-			top = image_data + row * width_in_bytes;
-			bottom = image_data + (y - row - 1) * width_in_bytes;
+	// Retrieves a texture associated with the object - by its name and type
+	gps::Texture Model3D::LoadTexture(std::string path, std::string type, const TextureCache::DecodedImageMap& images) {
 
-			for (int col = 0; col < width_in_bytes; col++) {
+		// shared across all models, the cache only uploads a path the first time it is seen
+		gps::Texture currentTexture;
+		currentTexture.id = TextureCache::acquire(path, images);
+		currentTexture.type = std::string(type);
+		currentTexture.path = path;
 
-				temp = *top;
-				*top = *bottom;
-				*bottom = temp;
-				top++;
-				bottom++;
-			}
-		}
+		loadedTextures.push_back(currentTexture);
 
-		GLuint textureID;
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_SRGB, //GL_SRGB,//GL_RGBA,
-			x,
-			y,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			image_data
-		);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		return textureID;
+		return currentTexture;
 	}
 
 	Model3D::~Model3D() {
 
         for (size_t i = 0; i < loadedTextures.size(); i++) {
 
-            glDeleteTextures(1, &loadedTextures.at(i).id);
-        }
-
-        for (size_t i = 0; i < meshes.size(); i++) {
-
-            GLuint VBO = meshes.at(i).getBuffers().VBO;
-            GLuint EBO = meshes.at(i).getBuffers().EBO;
-            GLuint VAO = meshes.at(i).getBuffers().VAO;
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteVertexArrays(1, &VAO);
+            TextureCache::release(loadedTextures.at(i).path);
         }
+        // the geometry stays in the shared GeometryBuffer until the context goes away
 	}
 }
@@ -2,11 +2,17 @@
 #define Model3D_hpp
 
 #include "Mesh.hpp"
+#include "TextureCache.hpp"
+#include "CapsuleCollider.hpp"
+#include "TriangleBVH.hpp"
+#include "WalkGrid.hpp"
 
 #include "tiny_obj_loader.h"
-#include "stb_image.h"
 
+#include <cstdint>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,9 +21,20 @@ namespace gps {
     class Model3D {
 
     public:
-        struct AABB {
-            glm::vec3 min;
-            glm::vec3 max;
+        using AABB = BoundingBox;
+
+        // CPU-side result of parsing a model, before anything touches the GL context.
+        // Texture entries only carry type and path, their ids are assigned on upload.
+        struct MeshData {
+            std::vector<gps::Vertex> vertices;
+            std::vector<GLuint> indices;
+            std::vector<gps::Texture> textures;
+            AABB bounds{};
+        };
+
+        struct ModelData {
+            std::vector<MeshData> meshes;
+            AABB bounds{};
         };
 
         ~Model3D();
@@ -26,40 +43,109 @@ namespace gps {
 
 		void LoadModel(std::string fileName, std::string basePath);
 
-		void Draw(gps::Shader shaderProgram);
+		// Two-phase loading: Prepare parses the model (or reads its cache) without a GL context,
+		// FinishLoading creates buffers and textures on the GL thread. LoadModel does both.
+		// Both throw std::runtime_error when the model can't be parsed.
+		void Prepare(std::string fileName);
+		void Prepare(std::string fileName, std::string basePath);
+		std::vector<std::string> GetTexturePaths() const;
+		// After Prepare: the walk grid and triangle BVH the flags below ask for. StartQueryData queues the
+		// BVH as a pool job and returns, so it may run on a worker (the parse job) and overlap FinishLoading.
+		// BuildWalkGrid then fans the walk grid out over the pool and FinishQueryData waits for the BVH;
+		// both block, never call them from a worker. BuildQueryData does everything inline.
+		void StartQueryData(ThreadPool& pool);
+		void BuildWalkGrid(ThreadPool* pool);
+		void FinishQueryData();
+		void BuildQueryData();
+		void FinishLoading(const TextureCache::DecodedImageMap& images);
+		// What Prepare produced, until FinishLoading consumes it
+		const ModelData& GetPreparedData() const { return pendingData; }
+
+		// One glMultiDrawElementsBaseVertex per run of meshes sharing the same textures
+		void Draw(const gps::Shader& shaderProgram);
+
+		// Batch access for RenderQueue; the caller has the program in use
+		size_t getBatchCount() const { return batches.size(); }
+		const Mesh::TextureSet& getBatchTextures(size_t batch) const { return meshes[batches[batch].firstMesh].getTextureSet(); }
+		// Meshes [first, first + count) of getMesh() make up the batch
+		size_t getBatchFirstMesh(size_t batch) const { return batches[batch].firstMesh; }
+		size_t getBatchMeshCount(size_t batch) const { return batches[batch].counts.size(); }
+		// meshVisible, when given, is indexed like getMesh() and leaves out the meshes set to 0
+		void DrawBatch(size_t batch, bool bindTextures, const uint8_t* meshVisible = nullptr) const;
+
+		size_t getMeshCount() const { return meshes.size(); }
+		const gps::Mesh& getMesh(size_t index) const { return meshes[index]; }
 
         AABB getBounds() const { return modelBounds; }
+
+        // Receiver-only geometry (the ocean) opts out of the shadow passes
+        bool castsShadows() const { return shadowCaster; }
+        void setCastsShadows(bool casts) { shadowCaster = casts; }
+        // Query data is only built for models that ask for it, before loading:
+        // walkable models get the floor grid and the BVH for collision, pickable ones the BVH for ray casts
+        void setWalkable(bool walkable) { this->walkable = walkable; }
+        void setPickable(bool pickable) { this->pickable = pickable; }
+
         bool getHeightAt(float x, float z, float currentY, float& outHeight) const;
+        // Batched getHeightAt, points are (x, currentY, z) in model space; see WalkGrid::getHeightsAt
+        void getHeightsAt(std::span<const glm::vec3> points, std::span<float> outHeights, std::span<uint8_t> outHits,
+                          ThreadPool* pool = nullptr) const;
+
+        // Ray queries against the model's triangles in model space, available once BuildQueryData has run.
+        // The direction is not normalized; see TriangleBVH
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const;
+        bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+        // Where a capsule at from ends up after moving by delta and sliding along the model, in model space
+        glm::vec3 moveCapsule(const Capsule& capsule, const glm::vec3& from, const glm::vec3& delta,
+                              CapsuleCollider::Stats* stats = nullptr) const;
 
     private:
 		// Component meshes - group of objects
         std::vector<gps::Mesh> meshes;
-		// Associated textures
+
+        // Meshes with identical texture sets, submitted together from the shared geometry buffer
+        struct MeshBatch {
+            size_t firstMesh;
+            std::vector<GLsizei> counts;
+            std::vector<const GLvoid*> offsets;
+            std::vector<GLint> baseVertices;
+        };
+        std::vector<MeshBatch> batches;
+		// Associated textures, one TextureCache reference each
         std::vector<gps::Texture> loadedTextures;
         AABB modelBounds{};
         bool boundsValid = false;
-        struct WalkTriangle {
-            glm::vec3 v0;
-            glm::vec3 v1;
-            glm::vec3 v2;
-        };
-
-        float walkCellSize = 0.5f;
-        int walkGridWidth = 0;
-        int walkGridHeight = 0;
-        glm::vec2 walkGridOrigin{};
-        std::vector<WalkTriangle> walkTriangles;
-        std::vector<std::vector<int>> walkGrid;
-        bool walkGridValid = false;
+        bool shadowCaster = true;
+        bool walkable = false;
+        bool pickable = false;
+        std::string sourceFile;
+        ModelData pendingData;
+
+        WalkGrid walkGrid;
+        TriangleBVH triangleBVH;
+        // query data builds still running, and how long the finished ones took
+        std::vector<std::future<void>> queryJobs;
+        // the walk grid's input, kept from StartQueryData until BuildWalkGrid
+        std::shared_ptr<const std::vector<glm::vec3>> walkGridVertices;
+        AABB walkGridBounds{};
+        double walkGridBuildMs = 0.0;
+        unsigned walkGridWorkers = 1;
+        double triangleBVHBuildMs = 0.0;
+
+        // Builds through pool when given, inline otherwise; only copies out of pendingData
+        void QueueQueryData(ThreadPool* pool);
 
 		// Does the parsing of the .obj file and fills in the data structure
-		void ReadOBJ(std::string fileName, std::string basePath);
+		void ReadOBJ(std::string fileName, std::string basePath, ModelData& data);
 
-		// Retrieves a texture associated with the object - by its name and type
-		gps::Texture LoadTexture(std::string path, std::string type);
+		// Creates the meshes and textures from parsed (or cached) model data
+		void Upload(const ModelData& data, const TextureCache::DecodedImageMap& images);
 
-		// Reads the pixel data from an image file and loads it into the video memory
-		GLuint ReadTextureFromFile(const char* file_name);
+		// Orders the meshes by texture set and groups them into batches
+		void BuildBatches();
+
+		// Retrieves a texture associated with the object - by its name and type
+		gps::Texture LoadTexture(std::string path, std::string type, const TextureCache::DecodedImageMap& images);
     };
 }
 
@@ -0,0 +1,269 @@
+#include "Profiler.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace gps {
+
+    bool Profiler::enabled = false;
+    bool Profiler::initialized = false;
+    std::chrono::steady_clock::time_point Profiler::epoch;
+    GLint64 Profiler::gpuEpoch = 0;
+
+    Profiler::Frame Profiler::frames[Profiler::FRAME_SLOTS];
+    unsigned Profiler::frameIndex = 0;
+    int Profiler::depth = 0;
+
+    std::vector<Profiler::ZoneStats> Profiler::summaries;
+    unsigned Profiler::summaryFrames = 0;
+    double Profiler::summaryWindowStart = 0.0;
+
+    std::vector<Profiler::ZoneStats> Profiler::totals;
+    unsigned Profiler::totalFrames = 0;
+
+    std::string Profiler::tracePath;
+    unsigned Profiler::traceFrameLimit = 0;
+    unsigned Profiler::traceFrames = 0;
+    std::vector<Profiler::TraceEvent> Profiler::traceEvents;
+
+    Profiler::Zone::Zone(const char* name) {
+
+        if (!enabled || !initialized) {
+            record = -1;
+            return;
+        }
+
+        Frame& frame = frames[frameIndex % FRAME_SLOTS];
+        record = static_cast<int>(frame.records.size());
+
+        Record entry;
+        entry.name = name;
+        entry.depth = depth++;
+        entry.gpuStart = nextQuery(frame, frame.records.size() * 2);
+        entry.gpuEnd = nextQuery(frame, frame.records.size() * 2 + 1);
+        glQueryCounter(entry.gpuStart, GL_TIMESTAMP);
+        entry.cpuStart = now();
+        entry.cpuEnd = entry.cpuStart;
+        frame.records.push_back(entry);
+        frame.pending = true;
+    }
+
+    Profiler::Zone::~Zone() {
+
+        if (record < 0) {
+            return;
+        }
+
+        Record& entry = frames[frameIndex % FRAME_SLOTS].records[record];
+        entry.cpuEnd = now();
+        glQueryCounter(entry.gpuEnd, GL_TIMESTAMP);
+        depth--;
+    }
+
+    double Profiler::now() {
+
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void Profiler::init() {
+
+        epoch = std::chrono::steady_clock::now();
+        glGetInteger64v(GL_TIMESTAMP, &gpuEpoch);
+        summaryWindowStart = 0.0;
+        initialized = true;
+    }
+
+    void Profiler::setTraceOutput(const std::string& path, unsigned maxFrames) {
+
+        tracePath = path;
+        traceFrameLimit = maxFrames;
+        traceFrames = 0;
+        traceEvents.clear();
+    }
+
+    GLuint Profiler::nextQuery(Frame& frame, size_t index) {
+
+        while (frame.queries.size() <= index) {
+            GLuint query = 0;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        return frame.queries[index];
+    }
+
+    void Profiler::beginFrame() {
+
+        if (!initialized) {
+            return;
+        }
+
+        // the slot about to be reused was recorded FRAME_SLOTS frames ago
+        frameIndex++;
+        Frame& frame = frames[frameIndex % FRAME_SLOTS];
+        if (frame.pending) {
+            resolve(frame);
+        }
+        frame.records.clear();
+        frame.pending = false;
+        depth = 0;
+
+        double time = now();
+        if (time - summaryWindowStart >= 1.0e6) {
+            if (enabled && summaryFrames > 0) {
+                printSummary();
+            }
+            summaries.clear();
+            summaryFrames = 0;
+            summaryWindowStart = time;
+        }
+    }
+
+    void Profiler::resolve(Frame& frame) {
+
+        bool tracing = !tracePath.empty() && traceFrames < traceFrameLimit;
+
+        for (const Record& entry : frame.records) {
+
+            // never wait: a result that is still missing after FRAME_SLOTS frames is dropped
+            GLint available = 0;
+            glGetQueryObjectiv(entry.gpuEnd, GL_QUERY_RESULT_AVAILABLE, &available);
+            GLuint64 gpuStart = 0;
+            GLuint64 gpuEnd = 0;
+            if (available) {
+                glGetQueryObjectui64v(entry.gpuStart, GL_QUERY_RESULT, &gpuStart);
+                glGetQueryObjectui64v(entry.gpuEnd, GL_QUERY_RESULT, &gpuEnd);
+            }
+
+            double gpuMs = static_cast<double>(gpuEnd - gpuStart) / 1.0e6;
+            accumulate(summaries, entry, available != 0, gpuMs);
+            accumulate(totals, entry, available != 0, gpuMs);
+
+            if (tracing) {
+                traceEvents.push_back({entry.name, false, entry.cpuStart, entry.cpuEnd - entry.cpuStart});
+                if (available) {
+                    double start = static_cast<double>(static_cast<GLint64>(gpuStart) - gpuEpoch) / 1000.0;
+                    traceEvents.push_back({entry.name, true, start, static_cast<double>(gpuEnd - gpuStart) / 1000.0});
+                }
+            }
+        }
+
+        summaryFrames++;
+        totalFrames++;
+        if (tracing) {
+            traceFrames++;
+        }
+    }
+
+    void Profiler::accumulate(std::vector<ZoneStats>& stats, const Record& entry, bool gpuValid, double gpuMs) {
+
+        ZoneStats* zone = nullptr;
+        for (ZoneStats& candidate : stats) {
+            if (candidate.depth == entry.depth && std::strcmp(candidate.name, entry.name) == 0) {
+                zone = &candidate;
+                break;
+            }
+        }
+        if (zone == nullptr) {
+            stats.push_back({entry.name, entry.depth, 0.0, 0.0, 0, 0});
+            zone = &stats.back();
+        }
+
+        zone->calls++;
+        zone->cpuMs += (entry.cpuEnd - entry.cpuStart) / 1000.0;
+        if (gpuValid) {
+            zone->gpuMs += gpuMs;
+            zone->gpuSamples++;
+        }
+    }
+
+    void Profiler::flush() {
+
+        if (!initialized) {
+            return;
+        }
+
+        glFinish();
+        // oldest first, the current slot last
+        for (unsigned i = 1; i <= FRAME_SLOTS; i++) {
+            Frame& frame = frames[(frameIndex + i) % FRAME_SLOTS];
+            if (frame.pending) {
+                resolve(frame);
+                frame.records.clear();
+                frame.pending = false;
+            }
+        }
+    }
+
+    void Profiler::resetTotals() {
+
+        totals.clear();
+        totalFrames = 0;
+    }
+
+    void Profiler::printSummary() {
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        out << "Profile: ms per frame over " << summaryFrames << " frames (CPU / GPU)" << std::endl;
+        for (const ZoneStats& summary : summaries) {
+
+            out << "  " << std::string(static_cast<size_t>(summary.depth) * 2, ' ') << summary.name << ": "
+                << summary.cpuMs / summaryFrames << " / ";
+            if (summary.gpuSamples > 0) {
+                out << summary.gpuMs / summaryFrames;
+            }
+            else {
+                out << "-";
+            }
+            out << std::endl;
+        }
+        std::cout << out.str();
+    }
+
+    void Profiler::writeTrace() {
+
+        std::ofstream file(tracePath);
+        if (!file) {
+            std::cerr << "Could not write profiler trace " << tracePath << std::endl;
+            return;
+        }
+
+        // Trace Event Format: complete ("X") events in microseconds, one track per timeline
+        file << std::fixed << std::setprecision(3);
+        file << "{\"traceEvents\":[" << std::endl;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}," << std::endl;
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+        for (const TraceEvent& event : traceEvents) {
+            file << "," << std::endl
+                 << "{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+                 << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1)
+                 << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+        }
+        file << std::endl << "]}" << std::endl;
+
+        std::cout << "Profiler trace: " << traceFrames << " frames written to " << tracePath << std::endl;
+    }
+
+    void Profiler::shutdown() {
+
+        if (!initialized) {
+            return;
+        }
+        if (!tracePath.empty()) {
+            writeTrace();
+        }
+
+        for (Frame& frame : frames) {
+            if (!frame.queries.empty()) {
+                glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+            }
+            frame.queries.clear();
+            frame.records.clear();
+            frame.pending = false;
+        }
+        initialized = false;
+    }
+}
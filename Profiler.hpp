@@ -0,0 +1,129 @@
+#ifndef Profiler_hpp
+#define Profiler_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Scoped CPU/GPU timing of the frame. Every Zone records two steady_clock samples and two
+    // GL_TIMESTAMP queries; a frame's queries are read back FRAME_SLOTS frames later, when the
+    // GPU is long done with them, so profiling never stalls the pipeline.
+    // Prints a rolling per-zone average once per second and can write a Chrome trace
+    // (chrome://tracing or ui.perfetto.dev) with CPU and GPU tracks.
+    class Profiler {
+
+    public:
+        // Times the enclosing scope. name must outlive the profiler (use string literals).
+        class Zone {
+
+        public:
+            explicit Zone(const char* name);
+            ~Zone();
+
+            Zone(const Zone&) = delete;
+            Zone& operator=(const Zone&) = delete;
+
+        private:
+            int record;
+        };
+
+        // Accumulated times of one zone, in first-seen order
+        struct ZoneStats {
+            const char* name;
+            int depth;
+            double cpuMs;
+            double gpuMs;
+            unsigned gpuSamples;
+            unsigned calls;
+        };
+
+        // GL thread, after the context exists; does nothing until enabled
+        static void init();
+        // Writes the trace file when one was requested, then releases the queries
+        static void shutdown();
+
+        static void setEnabled(bool enabled) { Profiler::enabled = enabled; }
+        static bool isEnabled() { return enabled; }
+        // Collect up to maxFrames frames into path, written by shutdown()
+        static void setTraceOutput(const std::string& path, unsigned maxFrames);
+
+        // Closes the previous frame; call once at the top of the main loop
+        static void beginFrame();
+
+        // Waits for the GPU and resolves every frame still in flight, e.g. before reading the totals
+        static void flush();
+        // Every resolved frame since init or resetTotals()
+        static const std::vector<ZoneStats>& getTotals() { return totals; }
+        static unsigned getTotalFrames() { return totalFrames; }
+        static void resetTotals();
+
+    private:
+        static const unsigned FRAME_SLOTS = 3;
+
+        struct Record {
+            const char* name;
+            int depth;
+            double cpuStart;
+            double cpuEnd;
+            GLuint gpuStart;
+            GLuint gpuEnd;
+        };
+
+        struct Frame {
+            std::vector<Record> records;
+            // GL_TIMESTAMP queries, two per record, reused from frame to frame
+            std::vector<GLuint> queries;
+            bool pending = false;
+        };
+
+        struct TraceEvent {
+            const char* name;
+            bool gpu;
+            double start;
+            double duration;
+        };
+
+        static bool enabled;
+        static bool initialized;
+        static std::chrono::steady_clock::time_point epoch;
+        // GL timestamp (ns) at epoch, maps GPU time onto the CPU timeline
+        static GLint64 gpuEpoch;
+
+        static Frame frames[FRAME_SLOTS];
+        static unsigned frameIndex;
+        static int depth;
+
+        // the current one-second window of the console summary
+        static std::vector<ZoneStats> summaries;
+        static unsigned summaryFrames;
+        static double summaryWindowStart;
+
+        static std::vector<ZoneStats> totals;
+        static unsigned totalFrames;
+
+        static std::string tracePath;
+        static unsigned traceFrameLimit;
+        static unsigned traceFrames;
+        static std::vector<TraceEvent> traceEvents;
+
+        // microseconds since epoch
+        static double now();
+        static GLuint nextQuery(Frame& frame, size_t index);
+        static void resolve(Frame& frame);
+        static void accumulate(std::vector<ZoneStats>& stats, const Record& entry, bool gpuValid, double gpuMs);
+        static void printSummary();
+        static void writeTrace();
+    };
+}
+
+#endif /* Profiler_hpp */
@@ -0,0 +1,166 @@
+#include "ProgramCache.hpp"
+#include "MappedFile.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace gps {
+
+    namespace {
+
+        const char CACHE_MAGIC[8] = {'G', 'P', 'S', 'P', 'R', 'O', 'G', '\0'};
+
+        struct CacheHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t binaryFormat;
+            uint64_t sourceHash;
+            uint32_t driverLength;
+            uint32_t binaryLength;
+        };
+
+        uint64_t hashText(uint64_t hash, const std::string& text) {
+            hash = hashCombine(hash, text.size());
+            for (unsigned char c : text) {
+                hash = (hash ^ c) * 1099511628211ull;
+            }
+            return hash;
+        }
+    }
+
+    std::string ProgramCache::cachePathFor(const std::string& vertexFileName, const std::string& fragmentFileName) {
+
+        std::filesystem::path path(vertexFileName);
+        std::string name = path.stem().string();
+        if (!fragmentFileName.empty()) {
+            name += "+" + std::filesystem::path(fragmentFileName).stem().string();
+        }
+        return (path.parent_path() / (name + ".progbin")).string();
+    }
+
+    uint64_t ProgramCache::sourceHash(const std::string& vertexSource, const std::string& fragmentSource) {
+
+        uint64_t hash = FINGERPRINT_SEED;
+        hash = hashCombine(hash, FORMAT_VERSION);
+        hash = hashText(hash, vertexSource);
+        hash = hashText(hash, fragmentSource);
+        return hash;
+    }
+
+    bool ProgramCache::supported() {
+
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    std::string ProgramCache::driverIdentity() {
+
+        std::string identity;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte* value = glGetString(name);
+            identity += value ? reinterpret_cast<const char*>(value) : "";
+            identity += '\n';
+        }
+        return identity;
+    }
+
+    bool ProgramCache::load(const std::string& cacheFileName, uint64_t sourceHash, GLuint& program) {
+
+        if (!readEnabled || !supported()) {
+            return false;
+        }
+
+        MappedFile file;
+        if (!file.open(cacheFileName) || file.size() < sizeof(CacheHeader)) {
+            return false;
+        }
+
+        CacheHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+            header.version != FORMAT_VERSION ||
+            header.sourceHash != sourceHash ||
+            header.driverLength > file.size() - sizeof(header) ||
+            header.binaryLength > file.size() - sizeof(header) - header.driverLength) {
+            return false;
+        }
+
+        // a binary from another driver build is rejected here rather than by a failed glProgramBinary
+        const char* driver = reinterpret_cast<const char*>(file.data() + sizeof(header));
+        if (std::string(driver, header.driverLength) != driverIdentity()) {
+            return false;
+        }
+
+        GLuint candidate = glCreateProgram();
+        glProgramBinary(candidate, header.binaryFormat, file.data() + sizeof(header) + header.driverLength,
+                        static_cast<GLsizei>(header.binaryLength));
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(candidate, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(candidate);
+            return false;
+        }
+
+        program = candidate;
+        return true;
+    }
+
+    bool ProgramCache::save(const std::string& cacheFileName, uint64_t sourceHash, GLuint program) {
+
+        if (!supported()) {
+            return false;
+        }
+
+        GLint binaryLength = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        if (binaryLength <= 0) {
+            return false;
+        }
+
+        std::vector<unsigned char> binary(static_cast<size_t>(binaryLength));
+        GLenum binaryFormat = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, binaryLength, &written, &binaryFormat, binary.data());
+        if (written <= 0) {
+            return false;
+        }
+
+        std::string driver = driverIdentity();
+
+        // write to a temporary file first so a crash never leaves a truncated cache behind
+        std::string tempFileName = cacheFileName + ".tmp";
+        {
+            std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                return false;
+            }
+
+            CacheHeader header{};
+            std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            header.version = FORMAT_VERSION;
+            header.binaryFormat = binaryFormat;
+            header.sourceHash = sourceHash;
+            header.driverLength = static_cast<uint32_t>(driver.size());
+            header.binaryLength = static_cast<uint32_t>(written);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(driver.data(), static_cast<std::streamsize>(driver.size()));
+            out.write(reinterpret_cast<const char*>(binary.data()), written);
+
+            if (!out) {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempFileName, cacheFileName, ec);
+        if (ec) {
+            std::filesystem::remove(tempFileName, ec);
+            return false;
+        }
+        return true;
+    }
+}
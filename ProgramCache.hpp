@@ -0,0 +1,50 @@
+#ifndef ProgramCache_hpp
+#define ProgramCache_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <cstdint>
+#include <string>
+
+namespace gps {
+
+    // Linked program binaries (glGetProgramBinary) stored next to the shader sources.
+    // A binary is only used when the source hash and the driver identity (vendor, renderer,
+    // version) match and the driver accepts it; anything else falls back to compiling.
+    class ProgramCache {
+
+    public:
+        // Bump whenever the file layout changes
+        static const uint32_t FORMAT_VERSION = 1;
+
+        // fragmentFileName is empty for vertex-only programs
+        static std::string cachePathFor(const std::string& vertexFileName, const std::string& fragmentFileName);
+
+        // Hash of the shader source text, so edits invalidate the binary without relying on timestamps
+        static uint64_t sourceHash(const std::string& vertexSource, const std::string& fragmentSource);
+
+        // Creates program from the cached binary; false (and program untouched) on any mismatch
+        static bool load(const std::string& cacheFileName, uint64_t sourceHash, GLuint& program);
+        // program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+        static bool save(const std::string& cacheFileName, uint64_t sourceHash, GLuint program);
+
+        // False when the driver offers no binary formats; load/save then do nothing
+        static bool supported();
+
+        // When disabled, existing binaries are ignored (but still rewritten), to time a cold start
+        static void setReadEnabled(bool enabled) { readEnabled = enabled; }
+
+    private:
+        static inline bool readEnabled = true;
+
+        static std::string driverIdentity();
+    };
+}
+
+#endif /* ProgramCache_hpp */
@@ -0,0 +1,198 @@
+#include "RenderQueue.hpp"
+#include "GLState.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace gps {
+
+    void RenderQueue::begin(const glm::mat4& viewMatrix) {
+
+        view = viewMatrix;
+        objects.clear();
+        items.clear();
+        visibility.clear();
+        stats = Stats();
+        cullingEnabled = false;
+        castersOnly = false;
+    }
+
+    void RenderQueue::setFrustum(const glm::mat4& viewProjection) {
+
+        frustum.extract(viewProjection);
+        cullingEnabled = true;
+    }
+
+    void RenderQueue::setShadowFrustum(const glm::mat4& lightSpace) {
+
+        frustum.extract(lightSpace, false);
+        cullingEnabled = true;
+        castersOnly = true;
+    }
+
+    bool RenderQueue::cullMeshes(const gps::Model3D& model, const glm::mat4& modelMatrix, size_t offset) {
+
+        const size_t meshCount = model.getMeshCount();
+        visibility.resize(offset + meshCount);
+
+        // whole model first, most objects are either fully in or fully out
+        Model3D::AABB bounds = model.getBounds();
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+        glm::mat3 absolute = glm::mat3(modelMatrix);
+        for (int column = 0; column < 3; column++) {
+            absolute[column] = glm::abs(absolute[column]);
+        }
+        glm::vec3 extent = absolute * ((bounds.max - bounds.min) * 0.5f);
+
+        if (!frustum.intersects(center, extent)) {
+            std::fill(visibility.begin() + offset, visibility.end(), 0);
+            return false;
+        }
+
+        boxCenterX.resize(meshCount);
+        boxCenterY.resize(meshCount);
+        boxCenterZ.resize(meshCount);
+        boxExtentX.resize(meshCount);
+        boxExtentY.resize(meshCount);
+        boxExtentZ.resize(meshCount);
+
+        // world box of each mesh: transformed centre, extent through |M| (stays conservative under rotation)
+        for (size_t i = 0; i < meshCount; i++) {
+
+            const BoundingBox& meshBounds = model.getMesh(i).getBounds();
+            glm::vec3 meshCenter = glm::vec3(modelMatrix * glm::vec4((meshBounds.min + meshBounds.max) * 0.5f, 1.0f));
+            glm::vec3 meshExtent = absolute * ((meshBounds.max - meshBounds.min) * 0.5f);
+            boxCenterX[i] = meshCenter.x;
+            boxCenterY[i] = meshCenter.y;
+            boxCenterZ[i] = meshCenter.z;
+            boxExtentX[i] = meshExtent.x;
+            boxExtentY[i] = meshExtent.y;
+            boxExtentZ[i] = meshExtent.z;
+        }
+
+        frustum.cullBoxes(boxCenterX.data(), boxCenterY.data(), boxCenterZ.data(),
+                          boxExtentX.data(), boxExtentY.data(), boxExtentZ.data(),
+                          meshCount, visibility.data() + offset);
+        return true;
+    }
+
+    void RenderQueue::submit(const gps::Shader& shader, const gps::Model3D& model, const glm::mat4& modelMatrix,
+                             const ObjectUniforms& uniforms, bool cullBackFaces, bool textured) {
+
+        if (castersOnly && !model.castsShadows()) {
+            return;
+        }
+
+        Object object;
+        object.shader = &shader;
+        object.model = &model;
+        object.modelMatrix = modelMatrix;
+        object.normalMatrix = glm::mat3(glm::inverseTranspose(view * modelMatrix));
+        object.uniforms = uniforms;
+        object.textured = textured;
+        object.visibilityOffset = NO_CULLING;
+
+        const uint8_t* meshVisible = nullptr;
+        if (cullingEnabled) {
+
+            object.visibilityOffset = visibility.size();
+            if (!cullMeshes(model, modelMatrix, object.visibilityOffset)) {
+                stats.meshesCulled += static_cast<unsigned>(model.getMeshCount());
+                return;
+            }
+            meshVisible = visibility.data() + object.visibilityOffset;
+        }
+        objects.push_back(object);
+
+        // distance along the view axis of the model's bounds centre, smaller is closer
+        Model3D::AABB bounds = model.getBounds();
+        glm::vec4 center = view * modelMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f);
+        float depth = -center.z;
+
+        for (size_t batch = 0; batch < model.getBatchCount(); batch++) {
+
+            size_t firstMesh = model.getBatchFirstMesh(batch);
+            bool anyVisible = false;
+            for (size_t mesh = firstMesh; mesh < firstMesh + model.getBatchMeshCount(batch); mesh++) {
+
+                if (meshVisible == nullptr || meshVisible[mesh]) {
+                    anyVisible = true;
+                    stats.meshesVisible++;
+                    stats.trianglesSubmitted += model.getMesh(mesh).getDrawRange().indexCount / 3;
+                }
+                else {
+                    stats.meshesCulled++;
+                }
+            }
+            if (!anyVisible) {
+                continue;
+            }
+
+            Item item;
+            item.program = shader.shaderProgram;
+            item.cullBackFaces = cullBackFaces;
+            item.textures = textured ? model.getBatchTextures(batch) : Mesh::TextureSet{};
+            item.depth = depth;
+            item.object = objects.size() - 1;
+            item.batch = batch;
+            items.push_back(item);
+        }
+    }
+
+    void RenderQueue::execute() {
+
+        std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+            if (a.program != b.program) {
+                return a.program < b.program;
+            }
+            if (a.cullBackFaces != b.cullBackFaces) {
+                return a.cullBackFaces;
+            }
+            if (a.textures != b.textures) {
+                return a.textures < b.textures;
+            }
+            return a.depth < b.depth;
+        });
+
+        // matrices are program state: re-upload only when a program sees a different object
+        std::vector<std::pair<GLuint, size_t>> uploadedObject;
+
+        for (const Item& item : items) {
+
+            const Object& object = objects[item.object];
+            object.shader->useShaderProgram();
+            GLState::setCullFace(item.cullBackFaces);
+
+            auto uploaded = std::find_if(uploadedObject.begin(), uploadedObject.end(),
+                                         [&](const std::pair<GLuint, size_t>& entry) { return entry.first == item.program; });
+            if (uploaded == uploadedObject.end() || uploaded->second != item.object) {
+
+                if (object.uniforms.modelLoc != -1) {
+                    glUniformMatrix4fv(object.uniforms.modelLoc, 1, GL_FALSE, glm::value_ptr(object.modelMatrix));
+                }
+                if (object.uniforms.normalMatrixLoc != -1) {
+                    glUniformMatrix3fv(object.uniforms.normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(object.normalMatrix));
+                }
+
+                if (uploaded == uploadedObject.end()) {
+                    uploadedObject.emplace_back(item.program, item.object);
+                }
+                else {
+                    uploaded->second = item.object;
+                }
+            }
+
+            const uint8_t* meshVisible = (object.visibilityOffset == NO_CULLING) ? nullptr
+                                                                                 : visibility.data() + object.visibilityOffset;
+            object.model->DrawBatch(item.batch, object.textured, meshVisible);
+        }
+
+        GLState::setCullFace(true);
+        objects.clear();
+        items.clear();
+        visibility.clear();
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef RenderQueue_hpp
+#define RenderQueue_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "Model3D.hpp"
+#include "Frustum.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    // Collects the draws of one pass and submits them in an order that minimises state changes:
+    // program, then face culling, then texture set, then front-to-back depth for early-Z.
+    // Per-frame uniforms (view, projection, lights) are the caller's job; the queue only uploads
+    // the per-object model and normal matrices.
+    class RenderQueue {
+
+    public:
+        struct ObjectUniforms {
+            GLint modelLoc = -1;
+            // -1 when the program takes no normal matrix (depth pass)
+            GLint normalMatrixLoc = -1;
+        };
+
+        struct Stats {
+            unsigned meshesVisible = 0;
+            unsigned meshesCulled = 0;
+            size_t trianglesSubmitted = 0;
+        };
+
+        // Starts a new pass; depth and normal matrices are computed against this view
+        void begin(const glm::mat4& viewMatrix);
+
+        // Culls the meshes of following submissions against viewProjection, until the next begin()
+        void setFrustum(const glm::mat4& viewProjection);
+
+        // Shadow-pass variant: culls against the light volume extended towards the light
+        // and drops models that do not cast shadows
+        void setShadowFrustum(const glm::mat4& lightSpace);
+
+        // Queues every draw batch of model. Untextured items skip texture binds (depth-only passes).
+        void submit(const gps::Shader& shader, const gps::Model3D& model, const glm::mat4& modelMatrix,
+                    const ObjectUniforms& uniforms, bool cullBackFaces = true, bool textured = true);
+
+        // Sorts and draws everything queued since begin(), then leaves back-face culling enabled
+        void execute();
+
+        size_t itemCount() const { return items.size(); }
+        // Counted by submit() since the last begin()
+        const Stats& getStats() const { return stats; }
+
+    private:
+        struct Object {
+            const gps::Shader* shader;
+            const gps::Model3D* model;
+            glm::mat4 modelMatrix;
+            glm::mat3 normalMatrix;
+            ObjectUniforms uniforms;
+            bool textured;
+            // offset of the object's per-mesh flags in visibility, NO_CULLING when all meshes are drawn
+            size_t visibilityOffset;
+        };
+
+        static const size_t NO_CULLING = static_cast<size_t>(-1);
+
+        struct Item {
+            // sort key, compared in this order
+            GLuint program;
+            bool cullBackFaces;
+            Mesh::TextureSet textures;
+            float depth;
+
+            size_t object;
+            size_t batch;
+        };
+
+        glm::mat4 view{1.0f};
+        std::vector<Object> objects;
+        std::vector<Item> items;
+        Stats stats;
+
+        bool cullingEnabled = false;
+        bool castersOnly = false;
+        Frustum frustum;
+        std::vector<uint8_t> visibility;
+        // world-space mesh boxes of the object being submitted, one array per component
+        std::vector<float> boxCenterX, boxCenterY, boxCenterZ;
+        std::vector<float> boxExtentX, boxExtentY, boxExtentZ;
+
+        // Fills visibility for model's meshes, returns false when none of them is visible
+        bool cullMeshes(const gps::Model3D& model, const glm::mat4& modelMatrix, size_t offset);
+    };
+}
+
+#endif /* RenderQueue_hpp */
@@ -7,6 +7,11 @@
 //
 
 #include "Shader.hpp"
+#include "GLState.hpp"
+#include "ProgramCache.hpp"
+#include "MappedFile.hpp"
+
+#include <chrono>
 
 namespace gps {
     std::string Shader::readShaderFile(std::string fileName) {
@@ -53,47 +58,254 @@ namespace gps {
         //check linking info
         glGetProgramiv(shaderProgramId, GL_LINK_STATUS, &success);
         if(!success) {
-            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            glGetProgramInfoLog(shaderProgramId, 512, NULL, infoLog);
             std::cout << "Shader linking error\n" << infoLog << std::endl;
         }
     }
     
-    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+    GLuint Shader::compileShader(GLenum type, const std::string& source) {
 
-        //read, parse and compile the vertex shader
-        std::string v = readShaderFile(vertexShaderFileName);
-        const GLchar* vertexShaderString = v.c_str();
-        GLuint vertexShader;
-        vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertexShader, 1, &vertexShaderString, NULL);
-        glCompileShader(vertexShader);
+        //parse and compile the shader
+        const GLchar* sourceString = source.c_str();
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &sourceString, NULL);
+        glCompileShader(shader);
         //check compilation status
-        shaderCompileLog(vertexShader);
-        
-        //read, parse and compile the vertex shader
-        std::string f = readShaderFile(fragmentShaderFileName);
-        const GLchar* fragmentShaderString = f.c_str();
-        GLuint fragmentShader;
-        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragmentShader, 1, &fragmentShaderString, NULL);
-        glCompileShader(fragmentShader);
-        //check compilation status
-        shaderCompileLog(fragmentShader);
-        
+        shaderCompileLog(shader);
+        return shader;
+    }
+
+    void Shader::linkProgram(GLuint vertexShader, GLuint fragmentShader) {
+
         //attach and link the shader programs
         this->shaderProgram = glCreateProgram();
         glAttachShader(this->shaderProgram, vertexShader);
-        glAttachShader(this->shaderProgram, fragmentShader);
+        if (fragmentShader != 0) {
+            glAttachShader(this->shaderProgram, fragmentShader);
+        }
+        //keep the linked binary retrievable for ProgramCache
+        glProgramParameteri(this->shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(this->shaderProgram);
         glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        if (fragmentShader != 0) {
+            glDeleteShader(fragmentShader);
+        }
         //check linking info
         shaderLinkLog(this->shaderProgram);
+
+        resolveUniforms();
+    }
+
+    void Shader::buildProgram(const std::string& vertexShaderFileName, const std::string& fragmentShaderFileName) {
+
+        auto start = std::chrono::steady_clock::now();
+
+        this->vertexFileName = vertexShaderFileName;
+        this->fragmentFileName = fragmentShaderFileName;
+        sourceStamp = sourcesStamp();
+
+        std::string vertexSource = readShaderFile(vertexShaderFileName);
+        std::string fragmentSource = fragmentShaderFileName.empty() ? std::string() : readShaderFile(fragmentShaderFileName);
+        uint64_t sourceHash = ProgramCache::sourceHash(vertexSource, fragmentSource);
+        std::string cachePath = ProgramCache::cachePathFor(vertexShaderFileName, fragmentShaderFileName);
+
+        bool cached = ProgramCache::load(cachePath, sourceHash, this->shaderProgram);
+        if (cached) {
+            resolveUniforms();
+        }
+        else {
+            GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+            GLuint fragmentShader = fragmentSource.empty() ? 0 : compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+            linkProgram(vertexShader, fragmentShader);
+
+            GLint linked = GL_FALSE;
+            glGetProgramiv(this->shaderProgram, GL_LINK_STATUS, &linked);
+            if (linked && !ProgramCache::save(cachePath, sourceHash, this->shaderProgram)) {
+                std::cerr << "Could not write program binary " << cachePath << std::endl;
+            }
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Shader " << vertexShaderFileName
+                  << (fragmentShaderFileName.empty() ? "" : " + " + fragmentShaderFileName) << ": "
+                  << (cached ? "program binary loaded" : "compiled and linked") << " in " << ms << " ms" << std::endl;
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName) {
+
+        buildProgram(vertexShaderFileName, fragmentShaderFileName);
+    }
+
+    void Shader::loadShader(std::string vertexShaderFileName) {
+
+        buildProgram(vertexShaderFileName, std::string());
+    }
+
+    void Shader::enableParallelCompile() {
+
+#if not defined (__APPLE__)
+        if (GLEW_KHR_parallel_shader_compile) {
+            // let the driver pick the thread count
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+            parallelCompile = true;
+        }
+#endif
+    }
+
+    uint64_t Shader::sourcesStamp() const {
+
+        uint64_t stamp = hashFileStamp(FINGERPRINT_SEED, vertexFileName);
+        if (!fragmentFileName.empty()) {
+            stamp = hashFileStamp(stamp, fragmentFileName);
+        }
+        return stamp;
+    }
+
+    Shader::ReloadResult Shader::pollReload(bool checkFiles) {
+
+        if (pendingProgram != 0) {
+            return finishReload();
+        }
+        if (!checkFiles || vertexFileName.empty()) {
+            return RELOAD_NONE;
+        }
+
+        uint64_t stamp = sourcesStamp();
+        if (stamp == sourceStamp) {
+            return RELOAD_NONE;
+        }
+        sourceStamp = stamp;
+        startReload();
+        // without the extension the link below simply blocks, on the first status query
+        return finishReload();
+    }
+
+    void Shader::startReload() {
+
+        reloadStart = std::chrono::steady_clock::now();
+
+        std::string vertexSource = readShaderFile(vertexFileName);
+        std::string fragmentSource = fragmentFileName.empty() ? std::string() : readShaderFile(fragmentFileName);
+        pendingSourceHash = ProgramCache::sourceHash(vertexSource, fragmentSource);
+
+        // no status queries here, they would wait for the compiler
+        const GLchar* vertexString = vertexSource.c_str();
+        pendingVertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pendingVertexShader, 1, &vertexString, NULL);
+        glCompileShader(pendingVertexShader);
+
+        pendingProgram = glCreateProgram();
+        glAttachShader(pendingProgram, pendingVertexShader);
+        if (!fragmentSource.empty()) {
+            const GLchar* fragmentString = fragmentSource.c_str();
+            pendingFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(pendingFragmentShader, 1, &fragmentString, NULL);
+            glCompileShader(pendingFragmentShader);
+            glAttachShader(pendingProgram, pendingFragmentShader);
+        }
+        glProgramParameteri(pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(pendingProgram);
+    }
+
+    Shader::ReloadResult Shader::finishReload() {
+
+        if (parallelCompile) {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(pendingProgram, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed) {
+                return RELOAD_NONE;
+            }
+        }
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(pendingProgram, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            std::cout << "Shader reload failed for " << vertexFileName << ", keeping the previous program" << std::endl;
+            shaderCompileLog(pendingVertexShader);
+            if (pendingFragmentShader != 0) {
+                shaderCompileLog(pendingFragmentShader);
+            }
+            shaderLinkLog(pendingProgram);
+        }
+
+        glDeleteShader(pendingVertexShader);
+        if (pendingFragmentShader != 0) {
+            glDeleteShader(pendingFragmentShader);
+        }
+        pendingVertexShader = 0;
+        pendingFragmentShader = 0;
+
+        GLuint replacement = pendingProgram;
+        pendingProgram = 0;
+        if (!linked) {
+            glDeleteProgram(replacement);
+            return RELOAD_FAILED;
+        }
+
+        // make the replacement current before the old id is freed, so GLState never holds a dead id
+        GLuint previous = this->shaderProgram;
+        this->shaderProgram = replacement;
+        GLState::useProgram(replacement);
+        glDeleteProgram(previous);
+        resolveUniforms();
+        ProgramCache::save(ProgramCache::cachePathFor(vertexFileName, fragmentFileName), pendingSourceHash, replacement);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reloadStart).count();
+        std::cout << "Shader " << vertexFileName << (fragmentFileName.empty() ? "" : " + " + fragmentFileName)
+                  << ": reloaded in " << ms << " ms" << std::endl;
+        return RELOAD_SWAPPED;
+    }
+
+    void Shader::resolveUniforms() {
+
+        uniformLocations.clear();
+
+        GLint uniformCount = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+        std::string name(static_cast<size_t>(maxNameLength > 0 ? maxNameLength : 1), '\0');
+        for (GLint i = 0; i < uniformCount; i++) {
+
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(this->shaderProgram, static_cast<GLuint>(i), maxNameLength, &length, &size, &type, &name[0]);
+
+            std::string uniformName = name.substr(0, static_cast<size_t>(length));
+            GLint location = glGetUniformLocation(this->shaderProgram, uniformName.c_str());
+            if (location < 0) {
+                // uniform block members have no location
+                continue;
+            }
+
+            uniformLocations[uniformName] = location;
+
+            //arrays are reported as "name[0]", make the bare name resolve too
+            size_t bracket = uniformName.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == uniformName.size()) {
+                uniformLocations[uniformName.substr(0, bracket)] = location;
+            }
+        }
+    }
+
+    GLint Shader::getUniformLocation(const std::string& name) const {
+
+        auto found = uniformLocations.find(name);
+        if (found != uniformLocations.end()) {
+            return found->second;
+        }
+
+        //not in the active list (e.g. "lights[3]"): ask once and remember the answer, -1 included
+        GLint location = glGetUniformLocation(this->shaderProgram, name.c_str());
+        uniformLocations[name] = location;
+        return location;
     }
     
-    void Shader::useShaderProgram() {
+    void Shader::useShaderProgram() const {
 
-        glUseProgram(this->shaderProgram);
+        GLState::useProgram(this->shaderProgram);
     }
 
 }
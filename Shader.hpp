@@ -17,9 +17,13 @@
     #include <GL/glew.h>
 #endif
 
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <unordered_map>
 
 
 namespace gps {
@@ -28,10 +32,54 @@ namespace gps {
 
     public:
         GLuint shaderProgram;
+        // Both overloads reuse the linked binary from ProgramCache when it matches the sources and
+        // the driver, and report the time each program took
         void loadShader(std::string vertexShaderFileName, std::string fragmentShaderFileName);
-        void useShaderProgram();
+        // Program without a fragment stage, for depth-only passes: depth is still written,
+        // no fragment shader runs at all
+        void loadShader(std::string vertexShaderFileName);
+        void useShaderProgram() const;
+
+        // Location from the table built at link time, -1 for names the program does not use
+        GLint getUniformLocation(const std::string& name) const;
+
+        enum ReloadResult { RELOAD_NONE, RELOAD_SWAPPED, RELOAD_FAILED };
+
+        // Hot reload, call every frame. With checkFiles the sources' size and mtime are compared
+        // and a change starts compiling a replacement in the background; the current program keeps
+        // drawing until the replacement links, and a broken edit leaves it in place. After
+        // RELOAD_SWAPPED shaderProgram is new and every uniform location must be fetched again.
+        ReloadResult pollReload(bool checkFiles);
+
+        // Once per context: lets the driver compile and link on its own threads
+        // (KHR_parallel_shader_compile) so pollReload never waits on the compiler
+        static void enableParallelCompile();
     
     private:
+        std::string vertexFileName;
+        std::string fragmentFileName;
+        // hashFileStamp of the sources when they were last read
+        uint64_t sourceStamp = 0;
+
+        // replacement being compiled by pollReload, 0 when none
+        GLuint pendingProgram = 0;
+        GLuint pendingVertexShader = 0;
+        GLuint pendingFragmentShader = 0;
+        uint64_t pendingSourceHash = 0;
+        std::chrono::steady_clock::time_point reloadStart;
+
+        static inline bool parallelCompile = false;
+
+        // Active uniforms resolved once after linking; array elements past [0] are filled in lazily
+        mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+        void resolveUniforms();
+        GLuint compileShader(GLenum type, const std::string& source);
+        void linkProgram(GLuint vertexShader, GLuint fragmentShader);
+        void buildProgram(const std::string& vertexShaderFileName, const std::string& fragmentShaderFileName);
+        uint64_t sourcesStamp() const;
+        void startReload();
+        ReloadResult finishReload();
         std::string readShaderFile(std::string fileName);
         void shaderCompileLog(GLuint shaderId);
         void shaderLinkLog(GLuint shaderProgramId);
@@ -0,0 +1,243 @@
+#include "ShadowCascades.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace gps {
+
+    namespace {
+
+        // The light sits this far from each cascade centre; the depth range covers casters on both sides
+        const float LIGHT_DISTANCE = 10000.0f;
+        const float LIGHT_DEPTH_RANGE = 20000.0f;
+    }
+
+    const char* ShadowCascades::filterName(int filter) {
+
+        switch (filter) {
+            case FILTER_HARDWARE: return "hardware PCF";
+            case FILTER_PCF_3X3: return "PCF 3x3";
+            case FILTER_PCF_5X5: return "PCF 5x5";
+            case FILTER_POISSON_16: return "Poisson 16";
+            default: return "unknown";
+        }
+    }
+
+    int ShadowCascades::filterTaps(int filter) {
+
+        switch (filter) {
+            case FILTER_HARDWARE: return 1;
+            case FILTER_PCF_3X3: return 9;
+            case FILTER_PCF_5X5: return 25;
+            case FILTER_POISSON_16: return 16;
+            default: return 0;
+        }
+    }
+
+    const char* ShadowCascades::depthFormatName(DepthFormat format) {
+
+        switch (format) {
+            case DEPTH_16: return "16-bit";
+            case DEPTH_24: return "24-bit";
+            case DEPTH_32F: return "32-bit float";
+            default: return "unknown";
+        }
+    }
+
+    GLuint ShadowCascades::createDepthArray(bool comparison) const {
+
+        // both arrays share the format, glBlitFramebuffer requires matching depth formats
+        GLenum internalFormat = GL_DEPTH_COMPONENT24;
+        GLenum type = GL_UNSIGNED_INT;
+        if (depthFormat == DEPTH_16) {
+            internalFormat = GL_DEPTH_COMPONENT16;
+            type = GL_UNSIGNED_SHORT;
+        }
+        else if (depthFormat == DEPTH_32F) {
+            internalFormat = GL_DEPTH_COMPONENT32F;
+            type = GL_FLOAT;
+        }
+
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, resolution, resolution, cascadeCount,
+                     0, GL_DEPTH_COMPONENT, type, NULL);
+        if (comparison) {
+            // the sampler compares against the reference depth and blends the 2x2 results
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+        else {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+
+    void ShadowCascades::init(int cascadeCount, int resolution, DepthFormat format) {
+
+        destroy();
+        this->cascadeCount = std::clamp(cascadeCount, 1, MAX_CASCADES);
+        this->resolution = resolution;
+        this->depthFormat = format;
+
+        // only the live array is sampled; the cached one is a blit source
+        depthTexture = createDepthArray(true);
+        staticTexture = createDepthArray(false);
+
+        for (GLuint* fbo : {&framebuffer, &staticFramebuffer}) {
+            glGenFramebuffers(1, fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                      (fbo == &framebuffer) ? depthTexture : staticTexture, 0, 0);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        invalidate();
+    }
+
+    void ShadowCascades::destroy() {
+
+        for (GLuint* fbo : {&framebuffer, &staticFramebuffer}) {
+            if (*fbo != 0) {
+                glDeleteFramebuffers(1, fbo);
+                *fbo = 0;
+            }
+        }
+        for (GLuint* texture : {&depthTexture, &staticTexture}) {
+            if (*texture != 0) {
+                glDeleteTextures(1, texture);
+                *texture = 0;
+            }
+        }
+    }
+
+    void ShadowCascades::invalidate() {
+
+        for (CachedRegion& region : cached) {
+            region.valid = false;
+        }
+    }
+
+    void ShadowCascades::update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDir) {
+
+        if (lightDir != cachedLightDir) {
+            // one rotation for all cascades; the boxes are placed with the ortho bounds
+            const glm::vec3 up = std::fabs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            lightViewMatrix = glm::lookAt(glm::vec3(0.0f), -lightDir, up);
+            cachedLightDir = lightDir;
+            invalidate();
+        }
+
+        const glm::mat4 inverseView = glm::inverse(view);
+        const float tanHalfY = std::tan(fovY * 0.5f);
+        const float tanHalfX = tanHalfY * aspect;
+
+        float sliceNear = nearPlane;
+        for (int i = 0; i < cascadeCount; i++) {
+
+            // practical split scheme: log spacing near the viewer, blended towards uniform
+            float fraction = static_cast<float>(i + 1) / static_cast<float>(cascadeCount);
+            float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, fraction);
+            float uniformSplit = nearPlane + (shadowDistance - nearPlane) * fraction;
+            float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+            splitDistances[i] = sliceFar;
+
+            // world-space corners of this slice of the view frustum
+            glm::vec3 corners[8];
+            int corner = 0;
+            for (float depth : {sliceNear, sliceFar}) {
+                for (float sx : {-1.0f, 1.0f}) {
+                    for (float sy : {-1.0f, 1.0f}) {
+                        glm::vec4 viewCorner(sx * tanHalfX * depth, sy * tanHalfY * depth, -depth, 1.0f);
+                        corners[corner++] = glm::vec3(inverseView * viewCorner);
+                    }
+                }
+            }
+            sliceNear = sliceFar;
+
+            // bounding sphere of the slice, its size does not change as the camera turns
+            glm::vec3 center(0.0f);
+            for (const glm::vec3& c : corners) {
+                center += c;
+            }
+            center /= 8.0f;
+            float radius = 0.0f;
+            for (const glm::vec3& c : corners) {
+                radius = std::max(radius, glm::length(c - center));
+            }
+
+            glm::vec3 lightCenter = glm::vec3(lightViewMatrix * glm::vec4(center, 1.0f));
+            CachedRegion& region = cached[i];
+            if (region.valid &&
+                std::fabs(lightCenter.x - region.center.x) + radius <= region.extent &&
+                std::fabs(lightCenter.y - region.center.y) + radius <= region.extent) {
+                continue;
+            }
+
+            // refit: round the size up so it rarely changes, snap the centre to whole texels so
+            // static shadow edges land on the same texels after every refit
+            region.valid = false;
+            region.extent = std::ceil(radius * cacheMargin);
+            float texelSize = 2.0f * region.extent / static_cast<float>(resolution);
+            region.center = glm::vec3(std::floor(lightCenter.x / texelSize) * texelSize,
+                                      std::floor(lightCenter.y / texelSize) * texelSize,
+                                      lightCenter.z);
+
+            // the eye is at the origin looking down -z: the light sits LIGHT_DISTANCE in front of the centre
+            float centerDistance = -region.center.z;
+            float nearDistance = centerDistance - LIGHT_DISTANCE + 1.0f;
+            glm::mat4 lightProjection = glm::ortho(region.center.x - region.extent, region.center.x + region.extent,
+                                                   region.center.y - region.extent, region.center.y + region.extent,
+                                                   nearDistance, nearDistance + LIGHT_DEPTH_RANGE - 1.0f);
+            lightSpaceMatrices[i] = lightProjection * lightViewMatrix;
+        }
+    }
+
+    void ShadowCascades::beginStatic(int cascade) {
+
+        glBindFramebuffer(GL_FRAMEBUFFER, staticFramebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticTexture, 0, cascade);
+        glViewport(0, 0, resolution, resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        cached[cascade].valid = true;
+        staticRenderCount++;
+    }
+
+    void ShadowCascades::beginCascade(int cascade) {
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFramebuffer);
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticTexture, 0, cascade);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, cascade);
+        glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, resolution, resolution);
+    }
+
+    void ShadowCascades::end() {
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    size_t ShadowCascades::getMemoryBytes() const {
+
+        // live and cached arrays; drivers pad 24-bit depth to 4 bytes per texel
+        size_t texelBytes = (depthFormat == DEPTH_16) ? 2 : 4;
+        return static_cast<size_t>(resolution) * resolution * cascadeCount * texelBytes * 2;
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef ShadowCascades_hpp
+#define ShadowCascades_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace gps {
+
+    // Directional-light cascaded shadow maps: the camera frustum up to shadowDistance is cut into
+    // cascadeCount slices, each rendered into one layer of a depth texture array with its own ortho fit.
+    //
+    // Static casters are rendered into a separate cached array. A cascade keeps its light matrix
+    // (snapped to whole texels) while its camera slice stays inside the cached region, and only then
+    // is the cache re-rendered; each frame the cached layer is copied into the live one and the
+    // dynamic casters are drawn on top.
+    class ShadowCascades {
+
+    public:
+        static const int MAX_CASCADES = 4;
+
+        // Soft-shadow kernels, matching shadowFilter in basic.frag/ocean.frag. Every tap is a
+        // hardware-filtered comparison (bilinear PCF over 2x2 texels), so the cost is the tap count.
+        enum Filter {
+            FILTER_HARDWARE,    // 1 tap
+            FILTER_PCF_3X3,     // 9 taps
+            FILTER_PCF_5X5,     // 25 taps
+            FILTER_POISSON_16,  // 16 taps on a Poisson disc
+            FILTER_COUNT
+        };
+        static const char* filterName(int filter);
+        static int filterTaps(int filter);
+
+        // Storage of both depth arrays. Each cascade spans 20000 units of light depth:
+        //   DEPTH_16   2 bytes/texel, ~0.3 unit steps; fine for the soft, far cascades
+        //   DEPTH_24   4 bytes/texel (padded), ~0.001 unit steps; the default
+        //   DEPTH_32F  4 bytes/texel, float precision; no memory saving over 24, only precision
+        enum DepthFormat {
+            DEPTH_16,
+            DEPTH_24,
+            DEPTH_32F
+        };
+        static const char* depthFormatName(DepthFormat format);
+
+        // GL thread; resolution is per cascade layer
+        void init(int cascadeCount, int resolution, DepthFormat format = DEPTH_24);
+        void destroy();
+
+        // Refits the cascades whose cached region no longer contains their slice of the camera frustum.
+        // fovY in radians; lightDir points towards the light.
+        void update(const glm::mat4& view, float fovY, float aspect, float nearPlane, const glm::vec3& lightDir);
+
+        // Drops every cached layer, e.g. when a static caster moved
+        void invalidate();
+
+        bool needsStaticRender(int cascade) const { return !cached[cascade].valid; }
+        // Targets the cached static layer of cascade and clears it; draw the static casters next
+        void beginStatic(int cascade);
+        // Copies the cached layer into the live one and targets it; draw the dynamic casters next
+        void beginCascade(int cascade);
+        // Back to the default framebuffer (the caller restores its viewport)
+        void end();
+
+        int getCascadeCount() const { return cascadeCount; }
+        int getResolution() const { return resolution; }
+        DepthFormat getDepthFormat() const { return depthFormat; }
+        GLuint getTexture() const { return depthTexture; }
+        const glm::mat4& getLightSpaceMatrix(int cascade) const { return lightSpaceMatrices[cascade]; }
+        // One light view for every cascade, only the ortho boxes differ
+        const glm::mat4& getSharedLightViewMatrix() const { return lightViewMatrix; }
+        const glm::mat4* getLightSpaceMatrices() const { return lightSpaceMatrices; }
+        // Far view-space distance of each cascade
+        const float* getSplitDistances() const { return splitDistances; }
+        size_t getMemoryBytes() const;
+        // Static layers rendered since init
+        unsigned getStaticRenderCount() const { return staticRenderCount; }
+
+        // Depth covered by the cascades, beyond it nothing is shadowed
+        float shadowDistance = 3000.0f;
+        // Blend between logarithmic (1) and uniform (0) split placement
+        float splitLambda = 0.75f;
+        // Cached region size relative to the slice's bounding sphere; larger reuses the cache
+        // for longer camera moves at the cost of texel density
+        float cacheMargin = 1.25f;
+
+    private:
+        struct CachedRegion {
+            bool valid = false;
+            // light-space centre (x, y snapped to texels) and half size of the ortho box
+            glm::vec3 center{0.0f};
+            float extent = 0.0f;
+        };
+
+        int cascadeCount = 0;
+        int resolution = 0;
+        DepthFormat depthFormat = DEPTH_24;
+        GLuint framebuffer = 0;
+        GLuint depthTexture = 0;
+        GLuint staticFramebuffer = 0;
+        GLuint staticTexture = 0;
+
+        glm::vec3 cachedLightDir{0.0f};
+        glm::mat4 lightViewMatrix{1.0f};
+        CachedRegion cached[MAX_CASCADES];
+        glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+        float splitDistances[MAX_CASCADES] = {};
+        unsigned staticRenderCount = 0;
+
+        // comparison enables GL_COMPARE_REF_TO_TEXTURE with linear filtering, for sampler2DArrayShadow
+        GLuint createDepthArray(bool comparison) const;
+    };
+}
+
+#endif /* ShadowCascades_hpp */
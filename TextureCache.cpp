@@ -0,0 +1,254 @@
+#include "TextureCache.hpp"
+
+#include "MappedFile.hpp"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace gps {
+
+    TextureCache::DecodedImage::~DecodedImage() {
+
+        if (pixels) {
+            stbi_image_free(pixels);
+        }
+    }
+
+    TextureCache::Registry& TextureCache::registry() {
+
+        static Registry* instance = new Registry();
+        return *instance;
+    }
+
+    std::string TextureCache::canonicalPath(const std::string& path) {
+
+        std::error_code ec;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+        if (ec) {
+            return std::filesystem::path(path).lexically_normal().generic_string();
+        }
+        return canonical.generic_string();
+    }
+
+    GLuint TextureCache::acquire(const std::string& path, const DecodedImageMap& decoded) {
+
+        std::string key = canonicalPath(path);
+        Registry& reg = registry();
+
+        {
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            auto found = reg.entries.find(key);
+            if (found != reg.entries.end()) {
+                found->second.refCount++;
+                reg.stats.hits++;
+                return found->second.id;
+            }
+        }
+
+        std::shared_ptr<const DecodedImage> image;
+        auto found = decoded.find(key);
+        if (found != decoded.end()) {
+            image = found->second;
+        }
+        else {
+            image = decode(path);
+        }
+
+        Entry entry;
+        entry.id = upload(image.get(), entry.bytes);
+        entry.refCount = 1;
+        entry.compressed = image && !image->compressed.levels.empty();
+
+        // failed loads are registered too (id 0) so the error is reported only once
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.entries.emplace(key, entry);
+        reg.stats.misses++;
+        reg.stats.textureCount = reg.entries.size();
+        if (entry.compressed) {
+            reg.stats.compressedCount++;
+        }
+        reg.stats.bytesResident += entry.bytes;
+        return entry.id;
+    }
+
+    void TextureCache::release(const std::string& path) {
+
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto found = reg.entries.find(canonicalPath(path));
+        if (found == reg.entries.end()) {
+            return;
+        }
+
+        if (--found->second.refCount > 0) {
+            return;
+        }
+
+        glDeleteTextures(1, &found->second.id);
+        reg.stats.bytesResident -= found->second.bytes;
+        if (found->second.compressed) {
+            reg.stats.compressedCount--;
+        }
+        reg.entries.erase(found);
+        reg.stats.textureCount = reg.entries.size();
+    }
+
+    bool TextureCache::isResident(const std::string& path) {
+
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        return reg.entries.find(canonicalPath(path)) != reg.entries.end();
+    }
+
+    bool TextureCache::compressionSupported() {
+
+#if defined (__APPLE__)
+        return false;
+#else
+        return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+#endif
+    }
+
+    // Decodes an image file into RGBA8 rows in file order (meshes flip v instead), safe to call from worker threads
+    std::shared_ptr<const TextureCache::DecodedImage> TextureCache::decode(const std::string& path) {
+
+        const bool compress = registry().compressionEnabled;
+        const std::string ktxPath = path + ".ktx";
+        const uint64_t fingerprint = hashCombine(hashFileStamp(FINGERPRINT_SEED, path), TRANSCODE_VERSION);
+
+        if (compress) {
+
+            auto image = std::make_shared<DecodedImage>();
+            if (TextureTranscoder::readKtx(ktxPath, fingerprint, image->compressed)) {
+                image->width = image->compressed.width;
+                image->height = image->compressed.height;
+                return image;
+            }
+        }
+
+        const char* file_name = path.c_str();
+        int x, y, n;
+        int force_channels = 4;
+        unsigned char* image_data = stbi_load(file_name, &x, &y, &n, force_channels);
+
+        if (!image_data) {
+            fprintf(stderr, "ERROR: could not load %s\n", file_name);
+            return nullptr;
+        }
+        // NPOT check
+        if ((x & (x - 1)) != 0 || (y & (y - 1)) != 0) {
+            fprintf(
+                stderr, "WARNING: texture %s is not power-of-2 dimensions\n", file_name
+            );
+        }
+
+        auto image = std::make_shared<DecodedImage>();
+        image->width = x;
+        image->height = y;
+
+        if (compress) {
+
+            // first run for this image: transcode once and keep the result for the next start
+            image->compressed = TextureTranscoder::compress(image_data, x, y);
+            stbi_image_free(image_data);
+            if (!TextureTranscoder::writeKtx(ktxPath, fingerprint, image->compressed)) {
+                fprintf(stderr, "WARNING: could not write %s\n", ktxPath.c_str());
+            }
+            return image;
+        }
+
+        image->pixels = image_data;
+        return image;
+    }
+
+    // Creates the GL texture for an already decoded image
+    GLuint TextureCache::upload(const DecodedImage* image, size_t& bytes) {
+
+        bytes = 0;
+        if (!image) {
+            return 0;
+        }
+
+        if (!image->compressed.levels.empty()) {
+            return uploadCompressed(image->compressed, bytes);
+        }
+
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            0,
+            GL_SRGB, //GL_SRGB,//GL_RGBA,
+            image->width,
+            image->height,
+            0,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            image->pixels
+        );
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // RGBA8 base level plus roughly a third more for the mip chain
+        size_t baseLevel = static_cast<size_t>(image->width) * static_cast<size_t>(image->height) * 4;
+        bytes = baseLevel + baseLevel / 3;
+
+        return textureID;
+    }
+
+    // Uploads a precomputed mip chain as is, no glGenerateMipmap needed
+    GLuint TextureCache::uploadCompressed(const CompressedImage& image, size_t& bytes) {
+
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+
+        for (size_t level = 0; level < image.levels.size(); level++) {
+            glCompressedTexImage2D(
+                GL_TEXTURE_2D,
+                static_cast<GLint>(level),
+                image.internalFormat,
+                std::max(1, image.width >> level),
+                std::max(1, image.height >> level),
+                0,
+                static_cast<GLsizei>(image.levels[level].size()),
+                image.levels[level].data()
+            );
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size()) - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        bytes = image.byteSize();
+        return textureID;
+    }
+
+    TextureCache::Stats TextureCache::getStats() {
+
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        return reg.stats;
+    }
+
+    void TextureCache::printStats() {
+
+        Stats current = getStats();
+        std::cout << "Texture cache: " << current.textureCount << " textures ("
+                  << current.compressedCount << " block-compressed), "
+                  << current.hits << " hits, " << current.misses << " misses, "
+                  << current.bytesResident / (1024.0 * 1024.0) << " MB resident" << std::endl;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef TextureCache_hpp
+#define TextureCache_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include "TextureTranscoder.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace gps {
+
+    // Process-wide registry of 2D textures keyed by canonical file path.
+    // Every model referencing an image shares one GL texture; it is deleted when the last reference is released.
+    class TextureCache {
+
+    public:
+        // Image prepared off the GL thread: either RGBA8 pixels (top row first, as decoded) or a block-compressed mip chain
+        struct DecodedImage {
+            int width = 0;
+            int height = 0;
+            unsigned char* pixels = nullptr;
+            CompressedImage compressed;
+            ~DecodedImage();
+        };
+        // Keyed by canonicalPath()
+        using DecodedImageMap = std::unordered_map<std::string, std::shared_ptr<const DecodedImage>>;
+
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t textureCount = 0;
+            size_t compressedCount = 0;
+            size_t bytesResident = 0;
+        };
+
+        static std::string canonicalPath(const std::string& path);
+
+        // Returns the texture for path, uploading it on first use (from decoded when present,
+        // otherwise read synchronously). GL thread only; each acquire needs a matching release.
+        static GLuint acquire(const std::string& path, const DecodedImageMap& decoded = {});
+        static void release(const std::string& path);
+
+        static bool isResident(const std::string& path);
+
+        // Loads an image on the calling thread, nullptr on failure. With compression enabled the
+        // <image>.ktx next to the source is used when current, otherwise it is transcoded and written.
+        static std::shared_ptr<const DecodedImage> decode(const std::string& path);
+
+        // GL thread: whether the context can sample sRGB BC1 textures
+        static bool compressionSupported();
+        // Set before loading starts; falls back to uncompressed RGBA8 uploads when disabled
+        static void setCompressionEnabled(bool enabled) { registry().compressionEnabled = enabled; }
+
+        static Stats getStats();
+        static void printStats();
+
+    private:
+        struct Entry {
+            GLuint id = 0;
+            int refCount = 0;
+            size_t bytes = 0;
+            // counted in Stats::compressedCount
+            bool compressed = false;
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::unordered_map<std::string, Entry> entries;
+            Stats stats;
+            std::atomic<bool> compressionEnabled{false};
+        };
+
+        // Never destroyed, models held in globals may release textures during static destruction
+        static Registry& registry();
+
+        // Bump when the pixels fed to the transcoder change, to invalidate existing .ktx files
+        static const uint64_t TRANSCODE_VERSION = 2;
+
+        static GLuint upload(const DecodedImage* image, size_t& bytes);
+        static GLuint uploadCompressed(const CompressedImage& image, size_t& bytes);
+    };
+}
+
+#endif /* TextureCache_hpp */
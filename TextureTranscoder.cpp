@@ -0,0 +1,394 @@
+#include "TextureTranscoder.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace gps {
+
+    namespace {
+
+        const unsigned char KTX_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+        const uint32_t KTX_ENDIANNESS = 0x04030201;
+        const char FINGERPRINT_KEY[] = "GPSSourceFingerprint";
+
+        struct KtxHeader {
+            unsigned char identifier[12];
+            uint32_t endianness;
+            uint32_t glType;
+            uint32_t glTypeSize;
+            uint32_t glFormat;
+            uint32_t glInternalFormat;
+            uint32_t glBaseInternalFormat;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t numberOfArrayElements;
+            uint32_t numberOfFaces;
+            uint32_t numberOfMipmapLevels;
+            uint32_t bytesOfKeyValueData;
+        };
+
+        // sRGB <-> linear lookup tables used by the mip filter
+        struct SrgbTables {
+            std::array<float, 256> toLinear;
+            std::array<unsigned char, 4096> fromLinear;
+
+            SrgbTables() {
+                for (int i = 0; i < 256; i++) {
+                    float c = i / 255.0f;
+                    toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                }
+                for (int i = 0; i < 4096; i++) {
+                    float l = i / 4095.0f;
+                    float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                    fromLinear[i] = static_cast<unsigned char>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+                }
+            }
+        };
+
+        const SrgbTables& srgbTables() {
+            static const SrgbTables tables;
+            return tables;
+        }
+
+        std::vector<unsigned char> downsample(const std::vector<unsigned char>& src, int width, int height,
+                                              int dstWidth, int dstHeight) {
+            const SrgbTables& tables = srgbTables();
+            std::vector<unsigned char> dst(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+            for (int y = 0; y < dstHeight; y++) {
+                int y0 = std::min(2 * y, height - 1);
+                int y1 = std::min(2 * y + 1, height - 1);
+                for (int x = 0; x < dstWidth; x++) {
+                    int x0 = std::min(2 * x, width - 1);
+                    int x1 = std::min(2 * x + 1, width - 1);
+                    const unsigned char* p[4] = {
+                        &src[(static_cast<size_t>(y0) * width + x0) * 4], &src[(static_cast<size_t>(y0) * width + x1) * 4],
+                        &src[(static_cast<size_t>(y1) * width + x0) * 4], &src[(static_cast<size_t>(y1) * width + x1) * 4]
+                    };
+                    unsigned char* out = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4];
+                    for (int c = 0; c < 3; c++) {
+                        float sum = tables.toLinear[p[0][c]] + tables.toLinear[p[1][c]] +
+                                    tables.toLinear[p[2][c]] + tables.toLinear[p[3][c]];
+                        out[c] = tables.fromLinear[static_cast<int>(sum * 0.25f * 4095.0f + 0.5f)];
+                    }
+                    out[3] = 255;
+                }
+            }
+            return dst;
+        }
+
+        uint16_t packRgb565(const float color[3]) {
+            int r = static_cast<int>(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+            int g = static_cast<int>(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+            int b = static_cast<int>(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+            return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+        }
+
+        void unpackRgb565(uint16_t packed, int color[3]) {
+            int r = (packed >> 11) & 31;
+            int g = (packed >> 5) & 63;
+            int b = packed & 31;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        // Endpoints from the extremes along the principal axis of the block's colours
+        void encodeBlockBC1(const unsigned char pixels[16][3], unsigned char out[8]) {
+
+            float mean[3] = {0.0f, 0.0f, 0.0f};
+            for (int i = 0; i < 16; i++) {
+                for (int c = 0; c < 3; c++) {
+                    mean[c] += pixels[i][c];
+                }
+            }
+            for (int c = 0; c < 3; c++) {
+                mean[c] /= 16.0f;
+            }
+
+            float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+            for (int i = 0; i < 16; i++) {
+                float r = pixels[i][0] - mean[0];
+                float g = pixels[i][1] - mean[1];
+                float b = pixels[i][2] - mean[2];
+                cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+                cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+            }
+
+            float axis[3] = {1.0f, 1.0f, 1.0f};
+            for (int iteration = 0; iteration < 8; iteration++) {
+                float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+                float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+                float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+                float length = std::max({std::fabs(x), std::fabs(y), std::fabs(z)});
+                if (length < 1e-6f) {
+                    break;
+                }
+                axis[0] = x / length;
+                axis[1] = y / length;
+                axis[2] = z / length;
+            }
+
+            float minT = 1e30f;
+            float maxT = -1e30f;
+            for (int i = 0; i < 16; i++) {
+                float t = (pixels[i][0] - mean[0]) * axis[0] + (pixels[i][1] - mean[1]) * axis[1] +
+                          (pixels[i][2] - mean[2]) * axis[2];
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+
+            float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+            if (axisLengthSq < 1e-12f) {
+                axisLengthSq = 1.0f;
+            }
+            float endA[3];
+            float endB[3];
+            for (int c = 0; c < 3; c++) {
+                endA[c] = mean[c] + axis[c] * maxT / axisLengthSq;
+                endB[c] = mean[c] + axis[c] * minT / axisLengthSq;
+            }
+
+            uint16_t color0 = packRgb565(endA);
+            uint16_t color1 = packRgb565(endB);
+            if (color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+                int c0[3];
+                int c1[3];
+                unpackRgb565(color0, c0);
+                unpackRgb565(color1, c1);
+                int palette[4][3];
+                for (int c = 0; c < 3; c++) {
+                    palette[0][c] = c0[c];
+                    palette[1][c] = c1[c];
+                    palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+                    palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestDistance = 1 << 30;
+                    for (int p = 0; p < 4; p++) {
+                        int dr = pixels[i][0] - palette[p][0];
+                        int dg = pixels[i][1] - palette[p][1];
+                        int db = pixels[i][2] - palette[p][2];
+                        int distance = dr * dr + dg * dg + db * db;
+                        if (distance < bestDistance) {
+                            bestDistance = distance;
+                            best = p;
+                        }
+                    }
+                    indices |= static_cast<uint32_t>(best) << (2 * i);
+                }
+            }
+
+            out[0] = static_cast<unsigned char>(color0 & 0xff);
+            out[1] = static_cast<unsigned char>(color0 >> 8);
+            out[2] = static_cast<unsigned char>(color1 & 0xff);
+            out[3] = static_cast<unsigned char>(color1 >> 8);
+            for (int i = 0; i < 4; i++) {
+                out[4 + i] = static_cast<unsigned char>((indices >> (8 * i)) & 0xff);
+            }
+        }
+
+        std::vector<unsigned char> encodeLevelBC1(const unsigned char* rgba, int width, int height) {
+
+            int blocksX = (width + 3) / 4;
+            int blocksY = (height + 3) / 4;
+            std::vector<unsigned char> encoded(static_cast<size_t>(blocksX) * blocksY * 8);
+
+            unsigned char block[16][3];
+            for (int by = 0; by < blocksY; by++) {
+                for (int bx = 0; bx < blocksX; bx++) {
+                    // edge blocks repeat the last row/column
+                    for (int py = 0; py < 4; py++) {
+                        int y = std::min(by * 4 + py, height - 1);
+                        for (int px = 0; px < 4; px++) {
+                            int x = std::min(bx * 4 + px, width - 1);
+                            const unsigned char* src = rgba + (static_cast<size_t>(y) * width + x) * 4;
+                            block[py * 4 + px][0] = src[0];
+                            block[py * 4 + px][1] = src[1];
+                            block[py * 4 + px][2] = src[2];
+                        }
+                    }
+                    encodeBlockBC1(block, &encoded[(static_cast<size_t>(by) * blocksX + bx) * 8]);
+                }
+            }
+            return encoded;
+        }
+    }
+
+    size_t CompressedImage::byteSize() const {
+
+        size_t total = 0;
+        for (const auto& level : levels) {
+            total += level.size();
+        }
+        return total;
+    }
+
+    CompressedImage TextureTranscoder::compress(const unsigned char* rgba, int width, int height) {
+
+        CompressedImage image;
+        image.internalFormat = COMPRESSED_FORMAT;
+        image.width = width;
+        image.height = height;
+
+        image.levels.push_back(encodeLevelBC1(rgba, width, height));
+
+        std::vector<unsigned char> current(rgba, rgba + static_cast<size_t>(width) * height * 4);
+        int levelWidth = width;
+        int levelHeight = height;
+        while (levelWidth > 1 || levelHeight > 1) {
+            int nextWidth = std::max(1, levelWidth / 2);
+            int nextHeight = std::max(1, levelHeight / 2);
+            current = downsample(current, levelWidth, levelHeight, nextWidth, nextHeight);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+            image.levels.push_back(encodeLevelBC1(current.data(), levelWidth, levelHeight));
+        }
+
+        return image;
+    }
+
+    bool TextureTranscoder::readKtx(const std::string& fileName, uint64_t fingerprint, CompressedImage& image) {
+
+        MappedFile file;
+        if (!file.open(fileName)) {
+            return false;
+        }
+
+        KtxHeader header;
+        if (file.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 ||
+            header.endianness != KTX_ENDIANNESS ||
+            header.glInternalFormat != COMPRESSED_FORMAT ||
+            header.numberOfFaces != 1 ||
+            header.numberOfMipmapLevels == 0 || header.numberOfMipmapLevels > 32 ||
+            header.bytesOfKeyValueData > file.size() - sizeof(header)) {
+            return false;
+        }
+
+        // look for our fingerprint in the key/value data
+        bool fingerprintMatches = false;
+        size_t offset = sizeof(header);
+        size_t keyValueEnd = offset + header.bytesOfKeyValueData;
+        while (offset + 4 <= keyValueEnd) {
+            uint32_t entrySize;
+            std::memcpy(&entrySize, file.data() + offset, 4);
+            offset += 4;
+            if (entrySize > keyValueEnd - offset) {
+                return false;
+            }
+            const char* entry = reinterpret_cast<const char*>(file.data() + offset);
+            if (entrySize == sizeof(FINGERPRINT_KEY) + sizeof(uint64_t) &&
+                std::memcmp(entry, FINGERPRINT_KEY, sizeof(FINGERPRINT_KEY)) == 0) {
+                uint64_t stored;
+                std::memcpy(&stored, entry + sizeof(FINGERPRINT_KEY), sizeof(stored));
+                fingerprintMatches = stored == fingerprint;
+            }
+            offset += (entrySize + 3) & ~3u;
+        }
+        if (!fingerprintMatches) {
+            return false;
+        }
+        offset = keyValueEnd;
+
+        CompressedImage result;
+        result.internalFormat = header.glInternalFormat;
+        result.width = static_cast<int>(header.pixelWidth);
+        result.height = static_cast<int>(header.pixelHeight);
+        result.levels.resize(header.numberOfMipmapLevels);
+
+        for (uint32_t level = 0; level < header.numberOfMipmapLevels; level++) {
+            uint32_t imageSize;
+            if (offset + 4 > file.size()) {
+                return false;
+            }
+            std::memcpy(&imageSize, file.data() + offset, 4);
+            offset += 4;
+
+            int levelWidth = std::max(1, result.width >> level);
+            int levelHeight = std::max(1, result.height >> level);
+            size_t expectedSize = static_cast<size_t>((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * 8;
+            if (imageSize != expectedSize || imageSize > file.size() - offset) {
+                return false;
+            }
+
+            result.levels[level].assign(file.data() + offset, file.data() + offset + imageSize);
+            offset += (imageSize + 3) & ~3u;
+        }
+
+        image = std::move(result);
+        return true;
+    }
+
+    bool TextureTranscoder::writeKtx(const std::string& fileName, uint64_t fingerprint, const CompressedImage& image) {
+
+        std::string tempFileName = fileName + ".tmp";
+        {
+            std::ofstream out(tempFileName, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                return false;
+            }
+
+            uint32_t entrySize = static_cast<uint32_t>(sizeof(FINGERPRINT_KEY) + sizeof(uint64_t));
+            uint32_t entryPadding = (4 - entrySize % 4) % 4;
+
+            KtxHeader header{};
+            std::memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+            header.endianness = KTX_ENDIANNESS;
+            header.glType = 0;
+            header.glTypeSize = 1;
+            header.glFormat = 0;
+            header.glInternalFormat = image.internalFormat;
+            header.glBaseInternalFormat = GL_RGB;
+            header.pixelWidth = static_cast<uint32_t>(image.width);
+            header.pixelHeight = static_cast<uint32_t>(image.height);
+            header.pixelDepth = 0;
+            header.numberOfArrayElements = 0;
+            header.numberOfFaces = 1;
+            header.numberOfMipmapLevels = static_cast<uint32_t>(image.levels.size());
+            header.bytesOfKeyValueData = 4 + entrySize + entryPadding;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            const char padding[4] = {0, 0, 0, 0};
+            out.write(reinterpret_cast<const char*>(&entrySize), 4);
+            out.write(FINGERPRINT_KEY, sizeof(FINGERPRINT_KEY));
+            out.write(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+            out.write(padding, entryPadding);
+
+            for (const auto& level : image.levels) {
+                uint32_t imageSize = static_cast<uint32_t>(level.size());
+                out.write(reinterpret_cast<const char*>(&imageSize), 4);
+                out.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+                out.write(padding, (4 - imageSize % 4) % 4);
+            }
+
+            if (!out) {
+                return false;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tempFileName, fileName, ec);
+        if (ec) {
+            std::filesystem::remove(tempFileName, ec);
+            return false;
+        }
+        return true;
+    }
+}
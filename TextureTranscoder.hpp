@@ -0,0 +1,45 @@
+#ifndef TextureTranscoder_hpp
+#define TextureTranscoder_hpp
+
+#if defined (__APPLE__)
+    #define GL_SILENCE_DEPRECATION
+    #include <OpenGL/gl3.h>
+#else
+    #define GLEW_STATIC
+    #include <GL/glew.h>
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gps {
+
+    // Block-compressed texture with its full mip chain, as stored in a KTX 1.1 file
+    struct CompressedImage {
+        GLenum internalFormat = 0;
+        int width = 0;
+        int height = 0;
+        std::vector<std::vector<unsigned char>> levels;
+
+        size_t byteSize() const;
+    };
+
+    // Offline/first-run transcoding of RGBA8 images to BC1 (DXT1) and the .ktx container holding them.
+    // Everything here is CPU only and safe to run on worker threads.
+    class TextureTranscoder {
+
+    public:
+        // sRGB BC1 without alpha: the uncompressed path uploads GL_SRGB, which drops alpha as well
+        static const GLenum COMPRESSED_FORMAT = 0x8C4C; // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+
+        // Builds the mip chain (filtered in linear space) and encodes every level
+        static CompressedImage compress(const unsigned char* rgba, int width, int height);
+
+        // The fingerprint is stored in the key/value data; files with another fingerprint are rejected
+        static bool readKtx(const std::string& fileName, uint64_t fingerprint, CompressedImage& image);
+        static bool writeKtx(const std::string& fileName, uint64_t fingerprint, const CompressedImage& image);
+    };
+}
+
+#endif /* TextureTranscoder_hpp */
@@ -0,0 +1,55 @@
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace gps {
+
+    // Fixed set of worker threads consuming a FIFO job queue.
+    // Jobs must not touch the GL context; results come back through std::future.
+    class ThreadPool {
+
+    public:
+        // 0 picks one worker per hardware thread
+        explicit ThreadPool(unsigned threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template <typename F>
+        auto submit(F&& job) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+
+            using Result = std::invoke_result_t<std::decay_t<F>>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+            std::future<Result> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                jobs.emplace_back([task]() { (*task)(); });
+            }
+            queueCondition.notify_one();
+            return result;
+        }
+
+        unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+        bool stopping = false;
+
+        void workerLoop();
+    };
+}
+
+#endif /* ThreadPool_hpp */
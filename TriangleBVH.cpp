@@ -0,0 +1,511 @@
+#include "TriangleBVH.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define GPS_BVH_SSE 1
+    #include <xmmintrin.h>
+#endif
+
+namespace gps {
+
+    namespace {
+
+        const int SAH_BINS = 16;
+        // ranges this small are never split, ranges above MAX_LEAF_SIZE always are
+        const uint32_t MIN_LEAF_SIZE = 2;
+        const uint32_t MAX_LEAF_SIZE = 8;
+        // cost of visiting a node relative to one triangle test
+        const float TRAVERSAL_COST = 1.0f;
+        // bounds the traversal stack: every 4-wide level pushes at most three more entries than it pops
+        const int MAX_DEPTH = 64;
+        const int STACK_SIZE = 3 * MAX_DEPTH + 4;
+
+        struct Box {
+            glm::vec3 min{std::numeric_limits<float>::max()};
+            glm::vec3 max{-std::numeric_limits<float>::max()};
+
+            void grow(const glm::vec3& point) {
+                min = glm::min(min, point);
+                max = glm::max(max, point);
+            }
+
+            void grow(const Box& box) {
+                min = glm::min(min, box.min);
+                max = glm::max(max, box.max);
+            }
+
+            float area() const {
+                glm::vec3 size = max - min;
+                if (size.x < 0.0f) {
+                    return 0.0f;
+                }
+                return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+            }
+        };
+
+        // binary tree of the build, collapsed into 4-wide nodes afterwards
+        struct BuildNode {
+            Box bounds;
+            uint32_t left = 0;
+            uint32_t right = 0;
+            uint32_t first = 0;
+            // 0 for inner nodes
+            uint32_t count = 0;
+        };
+
+        struct BuildContext {
+            std::vector<Box> triangleBounds;
+            std::vector<glm::vec3> centroids;
+            // permutation of the triangles, each leaf owns a contiguous range
+            std::vector<uint32_t> order;
+            std::vector<BuildNode> nodes;
+        };
+
+        uint32_t buildRange(BuildContext& context, uint32_t first, uint32_t count, int depth) {
+
+            const uint32_t index = static_cast<uint32_t>(context.nodes.size());
+            context.nodes.emplace_back();
+
+            Box bounds;
+            Box centroidBounds;
+            for (uint32_t i = first; i < first + count; i++) {
+                bounds.grow(context.triangleBounds[context.order[i]]);
+                centroidBounds.grow(context.centroids[context.order[i]]);
+            }
+            context.nodes[index].bounds = bounds;
+
+            if (count <= MIN_LEAF_SIZE || depth >= MAX_DEPTH) {
+                context.nodes[index].first = first;
+                context.nodes[index].count = count;
+                return index;
+            }
+
+            const glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+            int axis = 0;
+            if (extent.y > extent[axis]) {
+                axis = 1;
+            }
+            if (extent.z > extent[axis]) {
+                axis = 2;
+            }
+
+            uint32_t* begin = context.order.data() + first;
+            uint32_t* end = begin + count;
+            uint32_t* middle = begin + count / 2;
+
+            if (extent[axis] > 0.0f) {
+
+                // bin the centroids along the widest axis, then sweep the SAH cost of the SAH_BINS - 1 planes
+                const float binScale = SAH_BINS / extent[axis];
+                auto binOf = [&](uint32_t triangle) {
+                    int bin = static_cast<int>((context.centroids[triangle][axis] - centroidBounds.min[axis]) * binScale);
+                    return std::min(bin, SAH_BINS - 1);
+                };
+
+                Box binBounds[SAH_BINS];
+                uint32_t binCounts[SAH_BINS] = {};
+                for (uint32_t* it = begin; it != end; ++it) {
+                    int bin = binOf(*it);
+                    binBounds[bin].grow(context.triangleBounds[*it]);
+                    binCounts[bin]++;
+                }
+
+                float rightCost[SAH_BINS] = {};
+                Box accumulated;
+                uint32_t accumulatedCount = 0;
+                for (int bin = SAH_BINS - 1; bin > 0; bin--) {
+                    accumulated.grow(binBounds[bin]);
+                    accumulatedCount += binCounts[bin];
+                    rightCost[bin - 1] = accumulated.area() * accumulatedCount;
+                }
+
+                int bestPlane = -1;
+                float bestCost = std::numeric_limits<float>::max();
+                accumulated = Box();
+                accumulatedCount = 0;
+                for (int plane = 0; plane < SAH_BINS - 1; plane++) {
+                    accumulated.grow(binBounds[plane]);
+                    accumulatedCount += binCounts[plane];
+                    if (accumulatedCount == 0 || accumulatedCount == count) {
+                        continue;
+                    }
+                    float cost = accumulated.area() * accumulatedCount + rightCost[plane];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestPlane = plane;
+                    }
+                }
+
+                const float leafCost = bounds.area() * count;
+                const float splitCost = TRAVERSAL_COST * bounds.area() + bestCost;
+                if (count <= MAX_LEAF_SIZE && (bestPlane < 0 || splitCost >= leafCost)) {
+                    context.nodes[index].first = first;
+                    context.nodes[index].count = count;
+                    return index;
+                }
+
+                if (bestPlane >= 0) {
+                    middle = std::partition(begin, end, [&](uint32_t triangle) { return binOf(triangle) <= bestPlane; });
+                }
+                else {
+                    // every centroid fell into one bin: fall back to a median split
+                    std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+                        return context.centroids[a][axis] < context.centroids[b][axis];
+                    });
+                }
+            }
+            else if (count <= MAX_LEAF_SIZE) {
+                context.nodes[index].first = first;
+                context.nodes[index].count = count;
+                return index;
+            }
+
+            const uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+            const uint32_t left = buildRange(context, first, leftCount, depth + 1);
+            const uint32_t right = buildRange(context, first + leftCount, count - leftCount, depth + 1);
+            context.nodes[index].left = left;
+            context.nodes[index].right = right;
+            return index;
+        }
+
+        inline bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction,
+                                      const glm::vec3& v0, const glm::vec3& edge1, const glm::vec3& edge2,
+                                      float tMax, float& t) {
+
+            const glm::vec3 p = glm::cross(direction, edge2);
+            const float det = glm::dot(edge1, p);
+            if (det == 0.0f) {
+                return false;
+            }
+            const float invDet = 1.0f / det;
+
+            const glm::vec3 s = origin - v0;
+            const float u = glm::dot(s, p) * invDet;
+            if (u < 0.0f || u > 1.0f) {
+                return false;
+            }
+            const glm::vec3 q = glm::cross(s, edge1);
+            const float v = glm::dot(direction, q) * invDet;
+            if (v < 0.0f || u + v > 1.0f) {
+                return false;
+            }
+
+            t = glm::dot(edge2, q) * invDet;
+            return t > 0.0f && t < tMax;
+        }
+    }
+
+    void TriangleBVH::clear() {
+
+        nodes.clear();
+        triangles.clear();
+        triangleIds.clear();
+    }
+
+    void TriangleBVH::build(const std::vector<glm::vec3>& vertices) {
+
+        clear();
+        const uint32_t triangleCount = static_cast<uint32_t>(vertices.size() / 3);
+        if (triangleCount == 0) {
+            return;
+        }
+
+        BuildContext context;
+        context.triangleBounds.resize(triangleCount);
+        context.centroids.resize(triangleCount);
+        context.order.resize(triangleCount);
+        context.nodes.reserve(2 * triangleCount / MIN_LEAF_SIZE + 1);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            Box& box = context.triangleBounds[t];
+            box.grow(vertices[3 * t]);
+            box.grow(vertices[3 * t + 1]);
+            box.grow(vertices[3 * t + 2]);
+            context.centroids[t] = (box.min + box.max) * 0.5f;
+            context.order[t] = t;
+        }
+
+        buildRange(context, 0, triangleCount, 0);
+
+        triangles.resize(triangleCount);
+        triangleIds = context.order;
+        for (uint32_t i = 0; i < triangleCount; i++) {
+            const uint32_t t = context.order[i];
+            triangles[i] = {vertices[3 * t], vertices[3 * t + 1] - vertices[3 * t], vertices[3 * t + 2] - vertices[3 * t]};
+        }
+
+        // pull grandchildren up until each node has four children, always opening the largest inner child
+        nodes.reserve(context.nodes.size() / 2 + 1);
+        auto collapse = [&](auto& self, uint32_t buildIndex) -> uint32_t {
+
+            uint32_t children[4];
+            int childCount = 0;
+            const BuildNode& buildNode = context.nodes[buildIndex];
+            if (buildNode.count > 0) {
+                children[childCount++] = buildIndex;
+            }
+            else {
+                children[childCount++] = buildNode.left;
+                children[childCount++] = buildNode.right;
+                while (childCount < 4) {
+                    int open = -1;
+                    float openArea = -1.0f;
+                    for (int i = 0; i < childCount; i++) {
+                        const BuildNode& child = context.nodes[children[i]];
+                        if (child.count == 0 && child.bounds.area() > openArea) {
+                            open = i;
+                            openArea = child.bounds.area();
+                        }
+                    }
+                    if (open < 0) {
+                        break;
+                    }
+                    const BuildNode& opened = context.nodes[children[open]];
+                    children[open] = opened.left;
+                    children[childCount++] = opened.right;
+                }
+            }
+
+            const uint32_t index = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+            for (int i = 0; i < 4; i++) {
+                Node& node = nodes[index];
+                node.minX[i] = node.minY[i] = node.minZ[i] = 0.0f;
+                node.maxX[i] = node.maxY[i] = node.maxZ[i] = 0.0f;
+                node.child[i] = EMPTY;
+                node.count[i] = 0;
+            }
+
+            for (int i = 0; i < childCount; i++) {
+                const BuildNode& child = context.nodes[children[i]];
+                uint32_t target = child.first;
+                if (child.count == 0) {
+                    target = self(self, children[i]);
+                }
+
+                Node& node = nodes[index];
+                node.minX[i] = child.bounds.min.x;
+                node.minY[i] = child.bounds.min.y;
+                node.minZ[i] = child.bounds.min.z;
+                node.maxX[i] = child.bounds.max.x;
+                node.maxY[i] = child.bounds.max.y;
+                node.maxZ[i] = child.bounds.max.z;
+                node.child[i] = target;
+                node.count[i] = child.count;
+            }
+            return index;
+        };
+        collapse(collapse, 0);
+    }
+
+    template <bool AnyHit>
+    bool TriangleBVH::traverse(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit* hit) const {
+
+        if (nodes.empty()) {
+            return false;
+        }
+
+        // a zero component becomes a tiny one, so the slabs never compute 0 * inf
+        glm::vec3 invDirection;
+        for (int axis = 0; axis < 3; axis++) {
+            float d = direction[axis];
+            if (std::abs(d) < 1e-12f) {
+                d = std::copysign(1e-12f, d);
+            }
+            invDirection[axis] = 1.0f / d;
+        }
+
+        struct Entry {
+            uint32_t node;
+            float tNear;
+        };
+        Entry stack[STACK_SIZE];
+        int top = 0;
+        stack[top++] = {0, 0.0f};
+
+        float tMax = maxDistance;
+        bool found = false;
+        uint32_t nearest = 0;
+
+#if GPS_BVH_SSE
+        const __m128 ox = _mm_set1_ps(origin.x);
+        const __m128 oy = _mm_set1_ps(origin.y);
+        const __m128 oz = _mm_set1_ps(origin.z);
+        const __m128 ix = _mm_set1_ps(invDirection.x);
+        const __m128 iy = _mm_set1_ps(invDirection.y);
+        const __m128 iz = _mm_set1_ps(invDirection.z);
+        const __m128 zero = _mm_setzero_ps();
+#endif
+
+        while (top > 0) {
+
+            const Entry entry = stack[--top];
+            if (entry.tNear > tMax) {
+                continue;
+            }
+            const Node& node = nodes[entry.node];
+
+            float tNear[4];
+            int hitMask = 0;
+
+#if GPS_BVH_SSE
+            __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), ox), ix);
+            __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), ox), ix);
+            __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), oy), iy);
+            __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), oy), iy);
+            __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), oz), iz);
+            __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), oz), iz);
+
+            __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)),
+                                      _mm_max_ps(_mm_min_ps(z0, z1), zero));
+            __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)),
+                                     _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(tMax)));
+            hitMask = _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+            _mm_storeu_ps(tNear, enter);
+#else
+            for (int lane = 0; lane < 4; lane++) {
+                float x0 = (node.minX[lane] - origin.x) * invDirection.x;
+                float x1 = (node.maxX[lane] - origin.x) * invDirection.x;
+                float y0 = (node.minY[lane] - origin.y) * invDirection.y;
+                float y1 = (node.maxY[lane] - origin.y) * invDirection.y;
+                float z0 = (node.minZ[lane] - origin.z) * invDirection.z;
+                float z1 = (node.maxZ[lane] - origin.z) * invDirection.z;
+                float enter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+                float exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), tMax));
+                tNear[lane] = enter;
+                if (enter <= exit) {
+                    hitMask |= 1 << lane;
+                }
+            }
+#endif
+
+            // children hit, nearest first
+            int lanes[4];
+            int laneCount = 0;
+            for (int lane = 0; lane < 4; lane++) {
+                if (!(hitMask & (1 << lane)) || node.child[lane] == EMPTY) {
+                    continue;
+                }
+                int slot = laneCount++;
+                while (slot > 0 && tNear[lanes[slot - 1]] > tNear[lane]) {
+                    lanes[slot] = lanes[slot - 1];
+                    slot--;
+                }
+                lanes[slot] = lane;
+            }
+
+            // leaves right away, which can only shrink tMax; inner nodes pushed far to near
+            for (int k = 0; k < laneCount; k++) {
+                const int lane = lanes[k];
+                if (node.count[lane] == 0) {
+                    continue;
+                }
+                const uint32_t first = node.child[lane];
+                for (uint32_t i = first; i < first + node.count[lane]; i++) {
+                    const Triangle& triangle = triangles[i];
+                    float t;
+                    if (intersectTriangle(origin, direction, triangle.v0, triangle.edge1, triangle.edge2, tMax, t)) {
+                        if constexpr (AnyHit) {
+                            return true;
+                        }
+                        tMax = t;
+                        nearest = i;
+                        found = true;
+                    }
+                }
+            }
+            for (int k = laneCount - 1; k >= 0; k--) {
+                const int lane = lanes[k];
+                if (node.count[lane] == 0 && tNear[lane] <= tMax) {
+                    stack[top++] = {node.child[lane], tNear[lane]};
+                }
+            }
+        }
+
+        if (found && hit != nullptr) {
+            const Triangle& triangle = triangles[nearest];
+            glm::vec3 normal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+            if (glm::dot(normal, direction) > 0.0f) {
+                normal = -normal;
+            }
+            hit->distance = tMax;
+            hit->normal = normal;
+            hit->triangle = triangleIds[nearest];
+        }
+        return found;
+    }
+
+    void TriangleBVH::collectTriangles(const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                       std::vector<glm::vec3>& outVertices) const {
+
+        if (nodes.empty()) {
+            return;
+        }
+
+        uint32_t stack[STACK_SIZE];
+        int top = 0;
+        stack[top++] = 0;
+
+#if GPS_BVH_SSE
+        const __m128 queryMinX = _mm_set1_ps(boxMin.x);
+        const __m128 queryMinY = _mm_set1_ps(boxMin.y);
+        const __m128 queryMinZ = _mm_set1_ps(boxMin.z);
+        const __m128 queryMaxX = _mm_set1_ps(boxMax.x);
+        const __m128 queryMaxY = _mm_set1_ps(boxMax.y);
+        const __m128 queryMaxZ = _mm_set1_ps(boxMax.z);
+#endif
+
+        while (top > 0) {
+
+            const Node& node = nodes[stack[--top]];
+            int overlapMask = 0;
+
+#if GPS_BVH_SSE
+            __m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.minX), queryMaxX),
+                                        _mm_cmpge_ps(_mm_loadu_ps(node.maxX), queryMinX));
+            overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.minY), queryMaxY),
+                                                     _mm_cmpge_ps(_mm_loadu_ps(node.maxY), queryMinY)));
+            overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.minZ), queryMaxZ),
+                                                     _mm_cmpge_ps(_mm_loadu_ps(node.maxZ), queryMinZ)));
+            overlapMask = _mm_movemask_ps(overlap);
+#else
+            for (int lane = 0; lane < 4; lane++) {
+                if (node.minX[lane] <= boxMax.x && node.maxX[lane] >= boxMin.x &&
+                    node.minY[lane] <= boxMax.y && node.maxY[lane] >= boxMin.y &&
+                    node.minZ[lane] <= boxMax.z && node.maxZ[lane] >= boxMin.z) {
+                    overlapMask |= 1 << lane;
+                }
+            }
+#endif
+
+            for (int lane = 0; lane < 4; lane++) {
+                if (!(overlapMask & (1 << lane)) || node.child[lane] == EMPTY) {
+                    continue;
+                }
+                if (node.count[lane] == 0) {
+                    stack[top++] = node.child[lane];
+                    continue;
+                }
+                const uint32_t first = node.child[lane];
+                for (uint32_t i = first; i < first + node.count[lane]; i++) {
+                    const Triangle& triangle = triangles[i];
+                    outVertices.push_back(triangle.v0);
+                    outVertices.push_back(triangle.v0 + triangle.edge1);
+                    outVertices.push_back(triangle.v0 + triangle.edge2);
+                }
+            }
+        }
+    }
+
+    bool TriangleBVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const {
+
+        return traverse<false>(origin, direction, maxDistance, &hit);
+    }
+
+    bool TriangleBVH::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+
+        return traverse<true>(origin, direction, maxDistance, nullptr);
+    }
+}
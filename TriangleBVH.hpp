@@ -0,0 +1,75 @@
+#ifndef TriangleBVH_hpp
+#define TriangleBVH_hpp
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gps {
+
+    struct RayHit {
+        // along the ray, in multiples of its direction
+        float distance = 0.0f;
+        // geometric normal of the hit triangle, unit length and facing the ray origin
+        glm::vec3 normal{};
+        // index of the triangle in the list given to build()
+        uint32_t triangle = 0;
+    };
+
+    // Bounding volume hierarchy over a triangle soup for ray and overlap queries.
+    // Built top-down with binned SAH splits, then collapsed into a flat array of 4-wide nodes whose
+    // child boxes are stored SoA, so one SSE slab test checks all four children of a node.
+    // The direction of a query ray is not normalized: with an affine transform applied to both origin and
+    // direction, distances carry over unchanged between world and model space.
+    class TriangleBVH {
+
+    public:
+        // Three vertices per triangle
+        void build(const std::vector<glm::vec3>& vertices);
+        void clear();
+
+        bool isValid() const { return !nodes.empty(); }
+        size_t getTriangleCount() const { return triangles.size(); }
+        size_t getNodeCount() const { return nodes.size(); }
+
+        // Nearest triangle hit with 0 < distance < maxDistance
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const;
+        // Whether any triangle is hit with 0 < distance < maxDistance; stops at the first one found
+        bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+        // Appends the three vertices of every triangle in a leaf whose bounds overlap the box,
+        // a small superset of the triangles touching it
+        void collectTriangles(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<glm::vec3>& outVertices) const;
+
+    private:
+        // child slot without a child
+        static const uint32_t EMPTY = 0xffffffffu;
+
+        struct Node {
+            float minX[4], minY[4], minZ[4];
+            float maxX[4], maxY[4], maxZ[4];
+            // count == 0: index of an inner node; count > 0: first of count triangles of a leaf
+            uint32_t child[4];
+            uint32_t count[4];
+        };
+
+        // Möller-Trumbore form, in leaf order
+        struct Triangle {
+            glm::vec3 v0;
+            glm::vec3 edge1;
+            glm::vec3 edge2;
+        };
+
+        std::vector<Node> nodes;
+        std::vector<Triangle> triangles;
+        // leaf order -> build() order
+        std::vector<uint32_t> triangleIds;
+
+        template <bool AnyHit>
+        bool traverse(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit* hit) const;
+    };
+}
+
+#endif /* TriangleBVH_hpp */
@@ -0,0 +1,351 @@
+#include "WalkGrid.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define GPS_WALK_SSE 1
+    #include <xmmintrin.h>
+#endif
+
+namespace gps {
+
+    namespace {
+
+        // barycentric tolerance and degenerate-triangle threshold of the original per-triangle test
+        const float WALK_EPSILON = 1e-4f;
+        // fewer queries than this per worker are not worth a job
+        const size_t BATCH_MIN_CHUNK = 2048;
+        // same for triangles in a build
+        const size_t BUILD_MIN_CHUNK = 4096;
+    }
+
+    void WalkGrid::clear() {
+
+        width = 0;
+        height = 0;
+        triangleCount = 0;
+        cellOffsets.clear();
+        for (std::vector<float>* array : {&originX, &originZ, &vCoeffX, &vCoeffZ, &wCoeffX, &wCoeffZ,
+                                          &baseY, &slopeV, &slopeW, &firstCellX, &firstCellZ}) {
+            array->clear();
+        }
+    }
+
+    void WalkGrid::build(const std::vector<glm::vec3>& triangleVertices, float minNormalY,
+                         const glm::vec3& boundsMin, const glm::vec3& boundsMax, float cellSize, ThreadPool* pool) {
+
+        clear();
+        this->cellSize = cellSize;
+        origin = glm::vec2(boundsMin.x, boundsMin.z);
+        width = static_cast<int>(std::ceil((boundsMax.x - boundsMin.x) / cellSize)) + 1;
+        height = static_cast<int>(std::ceil((boundsMax.z - boundsMin.z) / cellSize)) + 1;
+
+        const size_t triangleTotal = triangleVertices.size() / 3;
+        const size_t cellCount = getCellCount();
+
+        struct Footprint {
+            int x0, x1, z0, z1;
+        };
+        std::vector<Footprint> footprints(triangleTotal);
+
+        // contiguous runs of triangles, one job each. Every chunk counts into and fills its own slots of
+        // each cell, laid out in chunk order, so cells list their triangles in input order for any chunk count.
+        size_t chunkCount = 1;
+        if (pool != nullptr) {
+            chunkCount = std::clamp<size_t>(triangleTotal / BUILD_MIN_CHUNK, 1, pool->size());
+        }
+        auto chunkStart = [&](size_t chunk) { return triangleTotal * chunk / chunkCount; };
+        auto forEachChunk = [&](const auto& work) {
+            if (chunkCount == 1) {
+                work(0);
+                return;
+            }
+            std::vector<std::future<void>> jobs;
+            jobs.reserve(chunkCount);
+            for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                jobs.push_back(pool->submit([&work, chunk]() { work(chunk); }));
+            }
+            for (auto& job : jobs) {
+                job.get();
+            }
+        };
+
+        // pass 1: keep the upward facing, non-degenerate triangles and count them per chunk and cell
+        std::vector<uint32_t> chunkSlots(chunkCount * cellCount, 0);
+        std::vector<size_t> chunkTriangles(chunkCount, 0);
+        forEachChunk([&](size_t chunk) {
+
+            uint32_t* counts = &chunkSlots[chunk * cellCount];
+            for (size_t t = chunkStart(chunk); t < chunkStart(chunk + 1); t++) {
+
+                Footprint& fp = footprints[t];
+                fp = {0, -1, 0, -1};
+
+                const glm::vec3& v0 = triangleVertices[3 * t];
+                const glm::vec3& v1 = triangleVertices[3 * t + 1];
+                const glm::vec3& v2 = triangleVertices[3 * t + 2];
+                // a degenerate triangle's NaN normal fails the test as well
+                const glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+                if (!(normal.y >= minNormalY)) {
+                    continue;
+                }
+                const glm::vec2 e0(v1.x - v0.x, v1.z - v0.z);
+                const glm::vec2 e1(v2.x - v0.x, v2.z - v0.z);
+                if (std::abs(e0.x * e1.y - e1.x * e0.y) < WALK_EPSILON) {
+                    continue;
+                }
+
+                fp.x0 = std::clamp(static_cast<int>(std::floor((std::min({v0.x, v1.x, v2.x}) - origin.x) / cellSize)), 0, width - 1);
+                fp.x1 = std::clamp(static_cast<int>(std::floor((std::max({v0.x, v1.x, v2.x}) - origin.x) / cellSize)), 0, width - 1);
+                fp.z0 = std::clamp(static_cast<int>(std::floor((std::min({v0.z, v1.z, v2.z}) - origin.y) / cellSize)), 0, height - 1);
+                fp.z1 = std::clamp(static_cast<int>(std::floor((std::max({v0.z, v1.z, v2.z}) - origin.y) / cellSize)), 0, height - 1);
+
+                for (int iz = fp.z0; iz <= fp.z1; ++iz) {
+                    for (int ix = fp.x0; ix <= fp.x1; ++ix) {
+                        counts[iz * width + ix]++;
+                    }
+                }
+                chunkTriangles[chunk]++;
+            }
+        });
+
+        // exclusive prefix sum, cell by cell and chunk by chunk within a cell: counts become first slots
+        cellOffsets.resize(cellCount + 1);
+        uint32_t running = 0;
+        for (size_t cell = 0; cell < cellCount; cell++) {
+            cellOffsets[cell] = running;
+            for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+                uint32_t count = chunkSlots[chunk * cellCount + cell];
+                chunkSlots[chunk * cellCount + cell] = running;
+                running += count;
+            }
+        }
+        cellOffsets[cellCount] = running;
+
+        for (std::vector<float>* array : {&originX, &originZ, &vCoeffX, &vCoeffZ, &wCoeffX, &wCoeffZ,
+                                          &baseY, &slopeV, &slopeW, &firstCellX, &firstCellZ}) {
+            array->resize(running);
+        }
+        for (size_t count : chunkTriangles) {
+            triangleCount += count;
+        }
+
+        // pass 2: every chunk writes its entries into the slots it counted
+        forEachChunk([&](size_t chunk) {
+
+            uint32_t* cursor = &chunkSlots[chunk * cellCount];
+            for (size_t t = chunkStart(chunk); t < chunkStart(chunk + 1); t++) {
+
+                const Footprint& fp = footprints[t];
+                if (fp.x1 < fp.x0) {
+                    continue;
+                }
+
+                // v and w of the original test are linear in p - a: fold the 1/denom into the coefficients
+                const glm::vec3& v0 = triangleVertices[3 * t];
+                const glm::vec3& v1 = triangleVertices[3 * t + 1];
+                const glm::vec3& v2 = triangleVertices[3 * t + 2];
+                const glm::vec2 e0(v1.x - v0.x, v1.z - v0.z);
+                const glm::vec2 e1(v2.x - v0.x, v2.z - v0.z);
+                const float denom = e0.x * e1.y - e1.x * e0.y;
+
+                for (int iz = fp.z0; iz <= fp.z1; ++iz) {
+                    for (int ix = fp.x0; ix <= fp.x1; ++ix) {
+                        const uint32_t e = cursor[iz * width + ix]++;
+                        originX[e] = v0.x;
+                        originZ[e] = v0.z;
+                        vCoeffX[e] = e1.y / denom;
+                        vCoeffZ[e] = -e1.x / denom;
+                        wCoeffX[e] = -e0.y / denom;
+                        wCoeffZ[e] = e0.x / denom;
+                        baseY[e] = v0.y;
+                        slopeV[e] = v1.y - v0.y;
+                        slopeW[e] = v2.y - v0.y;
+                        firstCellX[e] = static_cast<float>(fp.x0);
+                        firstCellZ[e] = static_cast<float>(fp.z0);
+                    }
+                }
+            }
+        });
+    }
+
+    void WalkGrid::scanCell(size_t begin, size_t end, float x, float z, float currentY,
+                            float cellX, float cellZ, float windowX, float windowZ,
+                            float& bestDiff, float& bestHeight) const {
+
+        size_t i = begin;
+
+#if GPS_WALK_SSE
+        const __m128 px = _mm_set1_ps(x);
+        const __m128 pz = _mm_set1_ps(z);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 minusEps = _mm_set1_ps(-WALK_EPSILON);
+        const __m128 targetY = _mm_set1_ps(currentY);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 cx = _mm_set1_ps(cellX);
+        const __m128 cz = _mm_set1_ps(cellZ);
+        const __m128 wx = _mm_set1_ps(windowX);
+        const __m128 wz = _mm_set1_ps(windowZ);
+
+        __m128 laneDiff = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 laneHeight = _mm_setzero_ps();
+
+        for (; i + 4 <= end; i += 4) {
+
+            __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&originX[i]));
+            __m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(&originZ[i]));
+            __m128 v = _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&vCoeffX[i])), _mm_mul_ps(dz, _mm_loadu_ps(&vCoeffZ[i])));
+            __m128 w = _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&wCoeffX[i])), _mm_mul_ps(dz, _mm_loadu_ps(&wCoeffZ[i])));
+            __m128 u = _mm_sub_ps(_mm_sub_ps(one, v), w);
+
+            __m128 accept = _mm_and_ps(_mm_cmpge_ps(u, minusEps),
+                                       _mm_and_ps(_mm_cmpge_ps(v, minusEps), _mm_cmpge_ps(w, minusEps)));
+            accept = _mm_and_ps(accept, _mm_cmpeq_ps(_mm_max_ps(_mm_loadu_ps(&firstCellX[i]), wx), cx));
+            accept = _mm_and_ps(accept, _mm_cmpeq_ps(_mm_max_ps(_mm_loadu_ps(&firstCellZ[i]), wz), cz));
+
+            __m128 y = _mm_add_ps(_mm_loadu_ps(&baseY[i]),
+                                  _mm_add_ps(_mm_mul_ps(v, _mm_loadu_ps(&slopeV[i])), _mm_mul_ps(w, _mm_loadu_ps(&slopeW[i]))));
+            __m128 diff = _mm_andnot_ps(signMask, _mm_sub_ps(y, targetY));
+
+            __m128 better = _mm_and_ps(accept, _mm_cmplt_ps(diff, laneDiff));
+            laneDiff = _mm_or_ps(_mm_and_ps(better, diff), _mm_andnot_ps(better, laneDiff));
+            laneHeight = _mm_or_ps(_mm_and_ps(better, y), _mm_andnot_ps(better, laneHeight));
+        }
+
+        float diffs[4];
+        float heights[4];
+        _mm_storeu_ps(diffs, laneDiff);
+        _mm_storeu_ps(heights, laneHeight);
+        for (int lane = 0; lane < 4; lane++) {
+            if (diffs[lane] < bestDiff) {
+                bestDiff = diffs[lane];
+                bestHeight = heights[lane];
+            }
+        }
+#endif
+
+        for (; i < end; i++) {
+
+            if (std::max(firstCellX[i], windowX) != cellX || std::max(firstCellZ[i], windowZ) != cellZ) {
+                continue;
+            }
+
+            float dx = x - originX[i];
+            float dz = z - originZ[i];
+            float v = dx * vCoeffX[i] + dz * vCoeffZ[i];
+            float w = dx * wCoeffX[i] + dz * wCoeffZ[i];
+            float u = 1.0f - v - w;
+            if (u < -WALK_EPSILON || v < -WALK_EPSILON || w < -WALK_EPSILON) {
+                continue;
+            }
+
+            float y = baseY[i] + v * slopeV[i] + w * slopeW[i];
+            float diff = std::abs(y - currentY);
+            if (diff < bestDiff) {
+                bestDiff = diff;
+                bestHeight = y;
+            }
+        }
+    }
+
+    bool WalkGrid::cellOf(float x, float z, int& ix, int& iz) const {
+
+        if (!isValid()) {
+            return false;
+        }
+        ix = static_cast<int>(std::floor((x - origin.x) / cellSize));
+        iz = static_cast<int>(std::floor((z - origin.y) / cellSize));
+        return ix >= 0 && ix < width && iz >= 0 && iz < height;
+    }
+
+    bool WalkGrid::heightInNeighbourhood(int ix, int iz, float x, float z, float currentY, float& outHeight) const {
+
+        // the 3x3 neighbourhood catches triangles that only reach the point within the epsilon
+        const int x0 = std::max(ix - 1, 0);
+        const int x1 = std::min(ix + 1, width - 1);
+        const int z0 = std::max(iz - 1, 0);
+        const int z1 = std::min(iz + 1, height - 1);
+
+        float bestDiff = std::numeric_limits<float>::max();
+        float bestHeight = 0.0f;
+        for (int cz = z0; cz <= z1; ++cz) {
+            for (int cx = x0; cx <= x1; ++cx) {
+                const size_t cell = static_cast<size_t>(cz) * width + cx;
+                scanCell(cellOffsets[cell], cellOffsets[cell + 1], x, z, currentY,
+                         static_cast<float>(cx), static_cast<float>(cz), static_cast<float>(x0), static_cast<float>(z0),
+                         bestDiff, bestHeight);
+            }
+        }
+
+        if (bestDiff == std::numeric_limits<float>::max()) {
+            return false;
+        }
+        outHeight = bestHeight;
+        return true;
+    }
+
+    bool WalkGrid::getHeightAt(float x, float z, float currentY, float& outHeight) const {
+
+        int ix, iz;
+        if (!cellOf(x, z, ix, iz)) {
+            return false;
+        }
+        return heightInNeighbourhood(ix, iz, x, z, currentY, outHeight);
+    }
+
+    void WalkGrid::getHeightsAt(std::span<const glm::vec3> points, std::span<float> outHeights, std::span<uint8_t> outHits,
+                                ThreadPool* pool) const {
+
+        const size_t count = std::min({points.size(), outHeights.size(), outHits.size()});
+
+        // (cell << 32 | query index) sorted: queries in the same cell reuse the same entries while they are in cache,
+        // points off the grid sort last and are answered as misses
+        std::vector<uint64_t> order(count);
+        size_t onGrid = 0;
+        for (size_t i = 0; i < count; i++) {
+            int ix, iz;
+            uint64_t cell = cellOf(points[i].x, points[i].z, ix, iz)
+                ? static_cast<uint64_t>(iz) * width + ix
+                : 0xffffffffull;
+            order[i] = (cell << 32) | i;
+            if (cell != 0xffffffffull) {
+                onGrid++;
+            }
+            else {
+                outHits[i] = 0;
+            }
+        }
+        std::sort(order.begin(), order.end());
+
+        auto run = [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                const uint32_t i = static_cast<uint32_t>(order[k]);
+                const uint32_t cell = static_cast<uint32_t>(order[k] >> 32);
+                const glm::vec3& point = points[i];
+                outHits[i] = heightInNeighbourhood(static_cast<int>(cell % width), static_cast<int>(cell / width),
+                                                   point.x, point.z, point.y, outHeights[i]) ? 1 : 0;
+            }
+        };
+
+        // contiguous ranges of the sorted order, so each worker keeps its own run of cells
+        const size_t chunks = pool != nullptr ? std::min<size_t>(pool->size(), onGrid / BATCH_MIN_CHUNK) : 0;
+        if (chunks < 2) {
+            run(0, onGrid);
+            return;
+        }
+
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(chunks);
+        for (size_t c = 0; c < chunks; c++) {
+            jobs.push_back(pool->submit([&run, begin = onGrid * c / chunks, end = onGrid * (c + 1) / chunks]() {
+                run(begin, end);
+            }));
+        }
+        for (auto& job : jobs) {
+            job.get();
+        }
+    }
+}
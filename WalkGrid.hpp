@@ -0,0 +1,73 @@
+#ifndef WalkGrid_hpp
+#define WalkGrid_hpp
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace gps {
+
+    class ThreadPool;
+
+    // Walkable triangles binned on the xz plane for floor height queries.
+    // Cells are stored CSR style: cell c owns entries [cellOffsets[c], cellOffsets[c + 1]).
+    // Each entry holds a copy of its triangle's barycentric and plane coefficients in SoA arrays,
+    // so a cell's entries are contiguous and tested four at a time.
+    class WalkGrid {
+
+    public:
+        // Bins the triangles (three vertices each, in the space of the bounds) whose unit normal has
+        // y >= minNormalY. With a pool, classification and both passes of the counting sort that fills
+        // the cells are split across its workers; the grid comes out the same either way.
+        void build(const std::vector<glm::vec3>& triangleVertices, float minNormalY,
+                   const glm::vec3& boundsMin, const glm::vec3& boundsMax, float cellSize, ThreadPool* pool = nullptr);
+        void clear();
+
+        bool isValid() const { return width > 0 && height > 0; }
+        size_t getCellCount() const { return static_cast<size_t>(width) * height; }
+        // Triangle references over all cells, a triangle counts once per cell it overlaps
+        size_t getEntryCount() const { return originX.size(); }
+        // Triangles that passed the normal test
+        size_t getTriangleCount() const { return triangleCount; }
+
+        // Of the triangles under (x, z), the height closest to currentY
+        bool getHeightAt(float x, float z, float currentY, float& outHeight) const;
+        // getHeightAt for every point (x, currentY, z): outHits[i] is 1 where outHeights[i] was written.
+        // Queries run in grid cell order; with a pool, large batches are split across its workers.
+        // Results are identical to calling getHeightAt per point.
+        void getHeightsAt(std::span<const glm::vec3> points, std::span<float> outHeights, std::span<uint8_t> outHits,
+                          ThreadPool* pool = nullptr) const;
+
+    private:
+        float cellSize = 0.5f;
+        int width = 0;
+        int height = 0;
+        glm::vec2 origin{};
+        size_t triangleCount = 0;
+
+        std::vector<uint32_t> cellOffsets;
+
+        // per entry, in cell order:
+        // barycentric v = dot(p - a, vCoeff), w = dot(p - a, wCoeff) with a = (originX, originZ)
+        std::vector<float> originX, originZ;
+        std::vector<float> vCoeffX, vCoeffZ;
+        std::vector<float> wCoeffX, wCoeffZ;
+        // height = baseY + v * slopeV + w * slopeW
+        std::vector<float> baseY, slopeV, slopeW;
+        // lowest cell of the triangle's footprint; a query tests an entry only in the first cell of its
+        // neighbourhood that the triangle overlaps, so triangles spanning cells are tested once
+        std::vector<float> firstCellX, firstCellZ;
+
+        // cell of (x, z), false outside the grid
+        bool cellOf(float x, float z, int& ix, int& iz) const;
+        bool heightInNeighbourhood(int ix, int iz, float x, float z, float currentY, float& outHeight) const;
+        void scanCell(size_t begin, size_t end, float x, float z, float currentY,
+                      float cellX, float cellZ, float windowX, float windowZ,
+                      float& bestDiff, float& bestHeight) const;
+    };
+}
+
+#endif /* WalkGrid_hpp */
@@ -1,8 +1,17 @@
 #include "Window.h"
 
+#include <cstdlib>
+
 namespace gps {
 
-    void Window::Create(int width, int height, const char *title) {
+    void Window::Create(int width, int height, const char *title, bool hidden) {
+#if defined (GLFW_PLATFORM_NULL) && defined (__linux__)
+        // GLFW 3.4+: nothing to open a window on, render into an offscreen software context
+        bool noDisplay = std::getenv("DISPLAY") == NULL && std::getenv("WAYLAND_DISPLAY") == NULL;
+        if (hidden && noDisplay) {
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        }
+#endif
         if (!glfwInit()) {
             throw std::runtime_error("Could not start GLFW3!");
         }
@@ -22,6 +31,15 @@ namespace gps {
         //for antialising
         glfwWindowHint(GLFW_SAMPLES, 4);
 
+        if (hidden) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#if defined (GLFW_PLATFORM_NULL) && defined (__linux__)
+            if (noDisplay) {
+                glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+            }
+#endif
+        }
+
         this->window = glfwCreateWindow(width, height, title, NULL, NULL);
         if (!this->window) {
             throw std::runtime_error("Could not create GLFW3 window!");
@@ -29,7 +47,8 @@ namespace gps {
 
         glfwMakeContextCurrent(window);
 
-        glfwSwapInterval(1);
+        // benchmark frames must not wait for the display
+        glfwSwapInterval(hidden ? 0 : 1);
 
 #if not defined (__APPLE__)
         // start GLEW extension handler
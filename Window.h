@@ -24,7 +24,9 @@ namespace gps {
     class Window {
 
     public:
-        void Create(int width=800, int height=600, const char *title="OpenGL Project");
+        // hidden: no visible window and no vsync, for benchmark runs. On Linux without a display
+        // server GLFW's null platform is used with an OSMesa (software) context where available.
+        void Create(int width=800, int height=600, const char *title="OpenGL Project", bool hidden=false);
         void Delete();
 
         GLFWwindow* getWindow();
@@ -17,11 +17,25 @@
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "Model3D.hpp"
+#include "MeshCache.hpp"
 #include "SkyBox.hpp"
-
+#include "ThreadPool.hpp"
+#include "AssetLoader.hpp"
+#include "Benchmark.hpp"
+#include "GLState.hpp"
+#include "RenderQueue.hpp"
+#include "ShadowCascades.hpp"
+#include "GpuTimer.hpp"
+#include "Profiler.hpp"
+#include "ProgramCache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <array>
+#include <chrono>
 #include <cmath>
+#include <string>
 
 // window
 gps::Window myWindow;
@@ -32,6 +46,7 @@ glm::mat4 view;
 glm::mat4 projection;
 glm::mat3 normalMatrix;
 glm::mat4 oceanModel;
+glm::mat4 moonModel;
 
 // light parameters
 glm::vec3 lightDir;
@@ -59,11 +74,21 @@ GLint shipProjectionLoc;
 GLint shipNormalMatrixLoc;
 GLint shipLightDirLoc;
 GLint shipLightColorLoc;
-GLint lightSpaceTrMatrixLoc;
+GLint lightSpaceTrMatricesLoc;
+GLint cascadeSplitsLoc;
+GLint cascadeCountLoc;
+GLint shadowFilterLoc;
 GLint shadowMapLoc;
-GLint oceanLightSpaceTrMatrixLoc;
+GLint oceanLightSpaceTrMatricesLoc;
+GLint oceanCascadeSplitsLoc;
+GLint oceanCascadeCountLoc;
+GLint oceanShadowFilterLoc;
 GLint oceanShadowMapLoc;
 GLint shipWorldMatrixLoc;
+GLint moonViewLoc;
+GLint moonProjectionLoc;
+GLint depthModelLoc;
+GLint depthLightSpaceTrMatrixLoc;
 
 // ship transform
 glm::mat4 shipModelMatrix;
@@ -75,7 +100,18 @@ gps::Camera myCamera(
     glm::vec3(8200.0f, 991.0f, -13609.0f),
     glm::vec3(0.0f, 1.0f, 0.0f));
 
-GLfloat cameraSpeed = 35.0f;
+// units per second, the old 35 per frame at 60 Hz
+GLfloat cameraSpeed = 2100.0f;
+
+// fixed-timestep simulation; frames render between the last two steps
+const double SIMULATION_STEP = 1.0 / 120.0;
+// longest frame fed to the simulation, a stall must not queue up hundreds of steps
+const double MAX_FRAME_DELTA = 0.25;
+double simulationAccumulator = 0.0;
+glm::vec3 previousCameraPosition(0.0f);
+// glfwSwapInterval: 1 vsync, 0 uncapped
+int swapInterval = 1;
+double shaderReloadLastCheck = 0.0;
 
 struct IntroKeyframe
 {
@@ -87,6 +123,14 @@ struct IntroKeyframe
 const float introDuration = 13.0f;
 float introStartTime = 0.0f;
 bool introActive = true;
+
+// --benchmark: hidden window, fixed simulated time step along the intro flythrough
+bool benchmarkMode = false;
+int benchmarkFrames = 0;
+std::string benchmarkOutput = "benchmark.json";
+const double BENCHMARK_TIME_STEP = 1.0 / 60.0;
+const int BENCHMARK_WARMUP_FRAMES = 30;
+double benchmarkTime = 0.0;
 bool resetMouseState = false;
 glm::vec3 shipIntroSpawnWorld(0.0f);
 bool collisionsEnabled = true;
@@ -98,11 +142,21 @@ enum RenderMode { RENDER_SOLID = 0, RENDER_WIREFRAME, RENDER_POLYGONAL, RENDER_S
 RenderMode currentRenderMode = RENDER_SOLID;
 
 // shadow mapping
-const GLuint SHADOW_WIDTH = 2048 * 4;
-const GLuint SHADOW_HEIGHT = 2048 * 4;
-GLuint shadowMapFBO;
-GLuint depthMapTexture;
-glm::mat4 lightSpaceTrMatrix;
+gps::ShadowCascades shadowCascades;
+int shadowFilter = gps::ShadowCascades::FILTER_PCF_3X3;
+float shadowCachedShipYaw = 0.0f;
+// summed over every cascade pass of the frame
+gps::RenderQueue::Stats shadowFrameStats;
+int shadowCascadeCount = 4;
+int shadowResolution = 2048;
+gps::ShadowCascades::DepthFormat shadowDepthFormat = gps::ShadowCascades::DEPTH_24;
+gps::GpuTimer shadowPassTimer;
+const GLuint SHADOW_MAP_TEXTURE_UNIT = 5;
+
+// camera projection
+const float CAMERA_FOV = 45.0f;
+const float CAMERA_NEAR_PLANE = 0.1f;
+const float CAMERA_FAR_PLANE = 10000.0f;
 
 // models
 gps::Model3D teapot;
@@ -112,17 +166,48 @@ gps::Model3D ocean;
 gps::Model3D moon;
 gps::Model3D ship;
 gps::SkyBox mySkyBox;
+
+// draw lists of the shadow and main passes, refilled every frame
+gps::RenderQueue shadowQueue;
+gps::RenderQueue sceneQueue;
 gps::Model3D::AABB shipBoundsLocal;
 
+// background workers for asset loading
+gps::ThreadPool workerPool;
+
 const float shipWalkMargin = 1.5f;
 float shipEyeHeightLocal = 1.7f;
 float shipFloorDefaultLocal = 0.0f;
+// walking collision capsule, ship-local units: from step height above the floor up to the eyes
+const float walkerRadiusLocal = 0.3f;
+const float walkerStepHeightLocal = 0.45f;
 
 GLfloat angle;
 
+// asset loading options
+bool textureCompressionRequested = true;
+
+// per-frame GL statistics, printed once per second while enabled
+bool frameStatsEnabled = false;
+double frameStatsWindowStart = 0.0;
+unsigned frameStatsFrames = 0;
+gps::GLState::Counters frameStatsTotals;
+gps::RenderQueue::Stats sceneStatsTotals;
+gps::RenderQueue::Stats shadowStatsTotals;
+unsigned frameStatsStaticRenders = 0;
+double shadowPassGpuMsTotal = 0.0;
+unsigned shadowPassGpuSamples = 0;
+double framePacingMin = 0.0;
+double framePacingMax = 0.0;
+double framePacingTotal = 0.0;
+unsigned framePacingSamples = 0;
+unsigned simulationStepsWindow = 0;
+gps::CapsuleCollider::Stats collisionStats;
+
 // pickup state
 enum HeldItem { HELD_NONE = 0, HELD_TEAPOT, HELD_NANOSUIT };
 HeldItem heldItem = HELD_NONE;
+const float pickupRange = 350.0f;
 glm::vec3 teapotWorldPos;
 glm::vec3 nanosuitWorldPos;
 glm::vec3 chestWorldPos;
@@ -289,6 +374,12 @@ void setCameraLookAt(const glm::vec3& position, const glm::vec3& target)
     myCamera.rotate(yaw, pitch);
 }
 
+// seconds driving the animation: wall clock, or the simulated clock of a benchmark run
+double appTime()
+{
+    return benchmarkMode ? benchmarkTime : glfwGetTime();
+}
+
 void intro()
 {
     if (!introActive)
@@ -305,7 +396,7 @@ void intro()
     const glm::vec3 shipCenter = shipWorldTranslation + shipWorldScale * shipLocalCenter;
     const glm::vec3 shipLookWorld = shipWorldTranslation + shipWorldScale * shipLookLocal;
 
-    float elapsed = static_cast<float>(glfwGetTime()) - introStartTime;
+    float elapsed = static_cast<float>(appTime()) - introStartTime;
     if (elapsed >= introDuration)
     {
         introActive = false;
@@ -395,6 +486,26 @@ void intro()
     updateViewUniforms();
 }
 
+// World-space ray against a model's triangles. The direction goes through the inverse model matrix
+// without being renormalized, so the hit distance stays in world units.
+bool raycastWorld(const gps::Model3D& model, const glm::mat4& modelMatrix, const glm::vec3& origin,
+                  const glm::vec3& direction, float maxDistance, gps::RayHit& hit)
+{
+    glm::mat4 invModel = glm::inverse(modelMatrix);
+    glm::vec3 localOrigin = glm::vec3(invModel * glm::vec4(origin, 1.0f));
+    glm::vec3 localDirection = glm::vec3(invModel * glm::vec4(direction, 0.0f));
+    return model.raycast(localOrigin, localDirection, maxDistance, hit);
+}
+
+// Line of sight between two world points, blocked by any ship triangle in between
+bool shipBlocksLine(const glm::vec3& from, const glm::vec3& to)
+{
+    glm::mat4 invShip = glm::inverse(shipModelMatrix);
+    glm::vec3 localFrom = glm::vec3(invShip * glm::vec4(from, 1.0f));
+    glm::vec3 localTo = glm::vec3(invShip * glm::vec4(to, 1.0f));
+    return ship.occluded(localFrom, localTo - localFrom, 1.0f);
+}
+
 void togglePickup()
 {
     if (introActive)
@@ -434,14 +545,41 @@ void togglePickup()
     }
 
     glm::vec3 camPos = myCamera.getPosition();
+    glm::vec3 front = glm::normalize(myCamera.getCameraFrontDirection());
+
+    // the item under the crosshair, unless part of the ship is in front of it
+    HeldItem lookedAt = HELD_NONE;
+    float lookDistance = pickupRange;
+    gps::RayHit hit;
+    if (raycastWorld(teapot, buildWorldMatrix(teapotWorldPos, 0.18f, glm::vec3(0.0f)),
+                     camPos, front, lookDistance, hit))
+    {
+        lookedAt = HELD_TEAPOT;
+        lookDistance = hit.distance;
+    }
+    if (raycastWorld(nanosuit, buildWorldMatrix(nanosuitWorldPos, 0.22f, glm::vec3(0.0f, 180.0f, 0.0f)),
+                     camPos, front, lookDistance, hit))
+    {
+        lookedAt = HELD_NANOSUIT;
+        lookDistance = hit.distance;
+    }
+    if (lookedAt != HELD_NONE && !shipBlocksLine(camPos, camPos + front * lookDistance))
+    {
+        heldItem = lookedAt;
+        return;
+    }
+
+    // otherwise the nearest item within reach that is in sight
     float distTeapot = glm::length(teapotWorldPos - camPos);
     float distNanosuit = glm::length(nanosuitWorldPos - camPos);
+    bool teapotInReach = distTeapot <= pickupRange && !shipBlocksLine(camPos, teapotWorldPos);
+    bool nanosuitInReach = distNanosuit <= pickupRange && !shipBlocksLine(camPos, nanosuitWorldPos);
 
-    if (distTeapot <= 350.0f && distTeapot <= distNanosuit)
+    if (teapotInReach && (!nanosuitInReach || distTeapot <= distNanosuit))
     {
         heldItem = HELD_TEAPOT;
     }
-    else if (distNanosuit <= 350.0f)
+    else if (nanosuitInReach)
     {
         heldItem = HELD_NANOSUIT;
     }
@@ -451,18 +589,37 @@ void clampCameraToShip(const glm::vec3& prevWorldPos)
 {
     glm::vec3 pos = myCamera.getPosition();
     glm::mat4 invShip = glm::inverse(shipModelMatrix);
-    glm::vec3 localPos = glm::vec3(invShip * glm::vec4(pos, 1.0f));
+    glm::vec3 prevLocal = glm::vec3(invShip * glm::vec4(prevWorldPos, 1.0f));
+    glm::vec3 targetLocal = glm::vec3(invShip * glm::vec4(pos, 1.0f));
+
+    // masts, cabins and railings: the walker slides along whatever the move runs into
+    float capsuleBottom = glm::min(walkerStepHeightLocal + walkerRadiusLocal - shipEyeHeightLocal, 0.0f);
+    gps::Capsule walker{walkerRadiusLocal, capsuleBottom, 0.0f};
+    glm::vec3 localPos = ship.moveCapsule(walker, prevLocal, targetLocal - prevLocal, &collisionStats);
 
     glm::vec3 minB = shipBoundsLocal.min + glm::vec3(shipWalkMargin, 0.0f, shipWalkMargin);
     glm::vec3 maxB = shipBoundsLocal.max - glm::vec3(shipWalkMargin, 0.0f, shipWalkMargin);
 
     localPos.x = glm::clamp(localPos.x, minB.x, maxB.x);
     localPos.z = glm::clamp(localPos.z, minB.z, maxB.z);
-    float floorHeight = 0.0f;
-    if (!ship.getHeightAt(localPos.x, localPos.z, localPos.y, floorHeight))
+
+    // past the edge of the walkable floor, keep the part of the move along the edge instead of stopping dead
+    const glm::vec3 candidates[3] = {
+        localPos,
+        glm::vec3(localPos.x, localPos.y, prevLocal.z),
+        glm::vec3(prevLocal.x, localPos.y, localPos.z)
+    };
+    // no floor under any of them (a gap in the walk grid): keep the collided position at the last floor height
+    float floorHeight = prevLocal.y - shipEyeHeightLocal;
+    for (const glm::vec3& candidate : candidates)
     {
-        myCamera.setPosition(prevWorldPos);
-        return;
+        float candidateFloor = 0.0f;
+        if (ship.getHeightAt(candidate.x, candidate.z, candidate.y, candidateFloor))
+        {
+            localPos = candidate;
+            floorHeight = candidateFloor;
+            break;
+        }
     }
 
     localPos.y = floorHeight + shipEyeHeightLocal;
@@ -471,27 +628,14 @@ void clampCameraToShip(const glm::vec3& prevWorldPos)
     myCamera.setPosition(clampedWorld);
 }
 
-glm::mat4 computeLightSpaceTrMatrix()
-{
-    const glm::vec3 sceneCenter = myCamera.getPosition();
-    const GLfloat lightDistance = 10000.0f;
-    glm::vec3 lightPos = sceneCenter + lightDir * lightDistance;
-    glm::mat4 lightView = glm::lookAt(lightPos, sceneCenter, glm::vec3(0.0f, 1.0f, 0.0f));
-    const GLfloat near_plane = 1.0f, far_plane = 20000.0f;
-    const GLfloat ortho_size = 3000.0f;
-    glm::mat4 lightProjection = glm::ortho(-ortho_size, ortho_size, -ortho_size, ortho_size,
-                                           near_plane, far_plane);
-    return lightProjection * lightView;
-}
-
 void windowResizeCallback(GLFWwindow* window, int width, int height)
 {
     fprintf(stdout, "Window resized! New width: %d , and height: %d\n", width, height);
     myWindow.setWindowDimensions({width, height});
     glViewport(0, 0, width, height);
-    projection = glm::perspective(glm::radians(45.0f),
+    projection = glm::perspective(glm::radians(CAMERA_FOV),
                                   (float)width / (float)height,
-                                  0.1f, 2000.0f);
+                                  CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
 
     myBasicShader.useShaderProgram();
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
@@ -500,6 +644,17 @@ void windowResizeCallback(GLFWwindow* window, int width, int height)
     glUniformMatrix4fv(oceanProjectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 }
 
+void applyShadowFilter()
+{
+    myBasicShader.useShaderProgram();
+    glUniform1i(shadowFilterLoc, shadowFilter);
+    oceanShader.useShaderProgram();
+    glUniform1i(oceanShadowFilterLoc, shadowFilter);
+
+    std::cout << "Shadow filter: " << gps::ShadowCascades::filterName(shadowFilter) << ", "
+              << gps::ShadowCascades::filterTaps(shadowFilter) << " taps per fragment" << std::endl;
+}
+
 void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mode)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
@@ -534,6 +689,29 @@ void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int
     {
         collisionsEnabled = !collisionsEnabled;
     }
+
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        frameStatsEnabled = !frameStatsEnabled;
+    }
+
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        gps::Profiler::setEnabled(!gps::Profiler::isEnabled());
+    }
+
+    if (key == GLFW_KEY_V && action == GLFW_PRESS)
+    {
+        swapInterval = (swapInterval == 0) ? 1 : 0;
+        glfwSwapInterval(swapInterval);
+        std::cout << "Swap interval: " << swapInterval << (swapInterval == 0 ? " (uncapped)" : " (vsync)") << std::endl;
+    }
+
+    if (key == GLFW_KEY_K && action == GLFW_PRESS)
+    {
+        shadowFilter = (shadowFilter + 1) % gps::ShadowCascades::FILTER_COUNT;
+        applyShadowFilter();
+    }
 }
 
 void mouseCallback(GLFWwindow* window, double xpos, double ypos)
@@ -590,36 +768,38 @@ void mouseCallback(GLFWwindow* window, double xpos, double ypos)
     updateViewUniforms();
 }
 
-void processMovement()
+// one simulation step of dt seconds
+void processMovement(float dt)
 {
     if (introActive)
     {
         return;
     }
 
+    const float distance = cameraSpeed * dt;
     bool moved = false;
     glm::vec3 prevPos = myCamera.getPosition();
     if (pressedKeys[GLFW_KEY_W])
     {
-        myCamera.move(gps::MOVE_FORWARD, cameraSpeed);
+        myCamera.move(gps::MOVE_FORWARD, distance);
         moved = true;
     }
 
     if (pressedKeys[GLFW_KEY_S])
     {
-        myCamera.move(gps::MOVE_BACKWARD, cameraSpeed);
+        myCamera.move(gps::MOVE_BACKWARD, distance);
         moved = true;
     }
 
     if (pressedKeys[GLFW_KEY_A])
     {
-        myCamera.move(gps::MOVE_LEFT, cameraSpeed);
+        myCamera.move(gps::MOVE_LEFT, distance);
         moved = true;
     }
 
     if (pressedKeys[GLFW_KEY_D])
     {
-        myCamera.move(gps::MOVE_RIGHT, cameraSpeed);
+        myCamera.move(gps::MOVE_RIGHT, distance);
         moved = true;
     }
 
@@ -635,7 +815,7 @@ void processMovement()
 
 void initOpenGLWindow()
 {
-    myWindow.Create(1024, 768, "OpenGL Project Core");
+    myWindow.Create(1024, 768, "OpenGL Project Core", benchmarkMode);
 }
 
 void setWindowCallbacks()
@@ -660,33 +840,141 @@ void initOpenGLState(){
 
 void initShadowMap()
 {
-    glGenFramebuffers(1, &shadowMapFBO);
-    glGenTextures(1, &depthMapTexture);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-                 SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMapTexture, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    shadowCascades.init(shadowCascadeCount, shadowResolution, shadowDepthFormat);
+    shadowPassTimer.init();
+    std::cout << "Shadow maps: " << shadowCascades.getCascadeCount() << " cascades of " << shadowCascades.getResolution()
+              << "x" << shadowCascades.getResolution() << ", "
+              << gps::ShadowCascades::depthFormatName(shadowCascades.getDepthFormat()) << " depth, "
+              << shadowCascades.getMemoryBytes() / (1024.0 * 1024.0) << " MB (live + cached static layers)" << std::endl;
 }
 
 void initModels()
 {
-    teapot.LoadModel("models/teapot/teapot20segUT.obj");
-    nanosuit.LoadModel("models/nanosuit/nanosuit.obj");
-    chest.LoadModel("models/chest/treasure_chest.obj");
-    ocean.LoadModel("models/ocean/ocean.obj");
-    moon.LoadModel("models/moon/moon.obj");
-    ship.LoadModel("models/ship/ship_v1_03.obj");
+    auto loadStart = std::chrono::steady_clock::now();
+
+    gps::TextureCache::setCompressionEnabled(textureCompressionRequested && gps::TextureCache::compressionSupported());
+
+    gps::AssetLoader loader(workerPool);
+    // only the ship is walked on and only the pickups are ray cast, the rest skip the query data
+    ship.setWalkable(true);
+    teapot.setPickable(true);
+    nanosuit.setPickable(true);
+    // the ship is the largest model, start it first
+    loader.addModel(ship, "models/ship/ship_v1_03.obj");
+    loader.addModel(teapot, "models/teapot/teapot20segUT.obj");
+    loader.addModel(nanosuit, "models/nanosuit/nanosuit.obj");
+    loader.addModel(chest, "models/chest/treasure_chest.obj");
+    loader.addModel(ocean, "models/ocean/ocean.obj");
+    ocean.setCastsShadows(false);
+    loader.addModel(moon, "models/moon/moon.obj");
+    loader.loadAll();
+
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    std::cout << "Models loaded in " << loadMs << " ms" << std::endl;
+}
+
+// returns false when the process should exit with exitCode instead of starting the app
+bool parseCommandLine(int argc, const char* argv[], int& exitCode)
+{
+    exitCode = EXIT_SUCCESS;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--bench-texture-flip")
+        {
+            exitCode = gps::Benchmark::textureFlip("models");
+            return false;
+        }
+        else if (arg == "--bench-walk-height")
+        {
+            exitCode = gps::Benchmark::walkHeight("models/ship/ship_v1_03.obj");
+            return false;
+        }
+        else if (arg == "--bench-raycast")
+        {
+            exitCode = gps::Benchmark::raycast("models/ship/ship_v1_03.obj");
+            return false;
+        }
+        else if (arg == "--rebuild-mesh-cache")
+        {
+            // ignore existing .meshcache files to time a cold start; they are rewritten
+            gps::MeshCache::setReadEnabled(false);
+        }
+        else if (arg == "--rebuild-program-cache")
+        {
+            // compile every shader from source to time a cold start; the .progbin files are rewritten
+            gps::ProgramCache::setReadEnabled(false);
+        }
+        else if (arg == "--no-texture-compression")
+        {
+            // upload plain RGBA8 and ignore the .ktx files, for memory/load time comparisons
+            textureCompressionRequested = false;
+        }
+        else if (arg == "--shadow-cascades" && i + 1 < argc)
+        {
+            // 1..4 slices of the view frustum, each with its own shadow map layer
+            shadowCascadeCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--shadow-resolution" && i + 1 < argc)
+        {
+            // texels per side of every cascade layer
+            shadowResolution = std::max(256, std::atoi(argv[++i]));
+        }
+        else if (arg == "--shadow-depth" && i + 1 < argc)
+        {
+            // depth bits of the shadow maps: 16 halves the memory and depth-pass bandwidth, 32 is float
+            int bits = std::atoi(argv[++i]);
+            shadowDepthFormat = (bits <= 16) ? gps::ShadowCascades::DEPTH_16
+                              : (bits >= 32) ? gps::ShadowCascades::DEPTH_32F
+                              : gps::ShadowCascades::DEPTH_24;
+        }
+        else if (arg == "--shadow-filter" && i + 1 < argc)
+        {
+            // soft-shadow quality tier: 0 hardware PCF, 1 PCF 3x3, 2 PCF 5x5, 3 Poisson 16 (cycle with K)
+            shadowFilter = std::clamp(std::atoi(argv[++i]), 0, gps::ShadowCascades::FILTER_COUNT - 1);
+        }
+        else if (arg == "--profile")
+        {
+            // per-zone CPU/GPU milliseconds once per second (toggle at runtime with O)
+            gps::Profiler::setEnabled(true);
+        }
+        else if (arg == "--profile-trace" && i + 1 < argc)
+        {
+            // Chrome trace of the first frames, for chrome://tracing or ui.perfetto.dev, written on exit
+            gps::Profiler::setEnabled(true);
+            gps::Profiler::setTraceOutput(argv[++i], 600);
+        }
+        else if (arg == "--swap-interval" && i + 1 < argc)
+        {
+            // 0 renders uncapped, N waits for N vblanks; the simulation rate does not change (toggle with V)
+            swapInterval = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--benchmark")
+        {
+            // deterministic flythrough of the intro in a hidden window, results written as JSON
+            benchmarkMode = true;
+            gps::Profiler::setEnabled(true);
+        }
+        else if (arg == "--benchmark-frames" && i + 1 < argc)
+        {
+            // frames to measure, default one pass of the intro at 60 simulated fps
+            benchmarkFrames = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--benchmark-output" && i + 1 < argc)
+        {
+            benchmarkOutput = argv[++i];
+        }
+        else if (arg == "--stats")
+        {
+            // print per-frame GL statistics once per second (toggle at runtime with P)
+            frameStatsEnabled = true;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << arg << std::endl;
+        }
+    }
+    return true;
 }
 
 void initObjectPositions()
@@ -724,11 +1012,22 @@ void initObjectPositions()
 
 void initShaders()
 {
+    auto shadersStart = std::chrono::steady_clock::now();
+    gps::Shader::enableParallelCompile();
     myBasicShader.loadShader("shaders/basic.vert", "shaders/basic.frag");
     oceanShader.loadShader("shaders/ocean.vert", "shaders/ocean.frag");
     moonShader.loadShader("shaders/moon.vert", "shaders/moon.frag");
     skyboxShader.loadShader("shaders/skyboxShader.vert", "shaders/skyboxShader.frag");
-    depthShader.loadShader("shaders/depthShader.vert", "shaders/depthShader.frag");
+    depthShader.loadShader("shaders/depthShader.vert");
+    std::cout << "Shaders ready in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shadersStart).count()
+              << " ms" << std::endl;
+
+    // material samplers live on fixed units for the lifetime of each program
+    gps::Mesh::bindSamplerUnits(myBasicShader);
+    gps::Mesh::bindSamplerUnits(oceanShader);
+    gps::Mesh::bindSamplerUnits(moonShader);
+
     skyboxShader.useShaderProgram();
 }
 
@@ -750,37 +1049,37 @@ void initUniforms()
 
     // create model matrix for teapot
     model = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-    modelLoc = glGetUniformLocation(myBasicShader.shaderProgram, "model");
+    modelLoc = myBasicShader.getUniformLocation("model");
 
     // get view matrix for current camera
     view = myCamera.getViewMatrix();
-    viewLoc = glGetUniformLocation(myBasicShader.shaderProgram, "view");
+    viewLoc = myBasicShader.getUniformLocation("view");
     // send view matrix to shader
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 
     // compute normal matrix for teapot
     normalMatrix = glm::mat3(glm::inverseTranspose(view * model));
-    normalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
+    normalMatrixLoc = myBasicShader.getUniformLocation("normalMatrix");
 
     // create projection matrix
-    projection = glm::perspective(glm::radians(45.0f),
+    projection = glm::perspective(glm::radians(CAMERA_FOV),
                                   (float)myWindow.getWindowDimensions().width / (float)myWindow.getWindowDimensions().
                                   height,
-                                  0.1f, 10000.0f);
+                                  CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
 
-    projectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
+    projectionLoc = myBasicShader.getUniformLocation("projection");
     // send projection matrix to shader
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
     //set the light direction (direction towards the light)
     lightDir = glm::normalize(glm::vec3(-0.2f, 1.0f, -0.3f)); // "de sus" ca luna
-    lightDirLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightDir");
+    lightDirLoc = myBasicShader.getUniformLocation("lightDir");
     // send light dir to shader
     glUniform3fv(lightDirLoc, 1, glm::value_ptr(lightDir));
 
     // set light color
     lightColor = glm::vec3(0.12f, 0.14f, 0.20f);
-    lightColorLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightColor");
+    lightColorLoc = myBasicShader.getUniformLocation("lightColor");
     glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
 
     oceanShader.useShaderProgram();
@@ -791,13 +1090,13 @@ void initUniforms()
     oceanModel = glm::scale(oceanModel, glm::vec3(60.0f));
 
     // get uniform locations for ocean shader
-    oceanModelLoc = glGetUniformLocation(oceanShader.shaderProgram, "model");
-    oceanNormalMatrixLoc = glGetUniformLocation(oceanShader.shaderProgram, "normalMatrix");
-    oceanTimeLoc = glGetUniformLocation(oceanShader.shaderProgram, "time");
-    oceanViewLoc = glGetUniformLocation(oceanShader.shaderProgram, "view");
-    oceanProjectionLoc = glGetUniformLocation(oceanShader.shaderProgram, "projection");
-    oceanLightDirLoc = glGetUniformLocation(oceanShader.shaderProgram, "lightDir");
-    oceanLightColorLoc = glGetUniformLocation(oceanShader.shaderProgram, "lightColor");
+    oceanModelLoc = oceanShader.getUniformLocation("model");
+    oceanNormalMatrixLoc = oceanShader.getUniformLocation("normalMatrix");
+    oceanTimeLoc = oceanShader.getUniformLocation("time");
+    oceanViewLoc = oceanShader.getUniformLocation("view");
+    oceanProjectionLoc = oceanShader.getUniformLocation("projection");
+    oceanLightDirLoc = oceanShader.getUniformLocation("lightDir");
+    oceanLightColorLoc = oceanShader.getUniformLocation("lightColor");
 
     // send view and projection matrices to ocean shader
     glUniformMatrix4fv(oceanViewLoc, 1, GL_FALSE, glm::value_ptr(view));
@@ -809,7 +1108,7 @@ void initUniforms()
 
     skyboxShader.useShaderProgram();
 
-    GLint skyLightDirLoc = glGetUniformLocation(skyboxShader.shaderProgram, "lightDir");
+    GLint skyLightDirLoc = skyboxShader.getUniformLocation("lightDir");
 
     if (skyLightDirLoc != -1)
         glUniform3fv(skyLightDirLoc, 1, glm::value_ptr(lightDir));
@@ -819,229 +1118,486 @@ void initUniforms()
     glm::vec3 moonWorldPos = glm::vec3(-7000.0f, 5000.0f, -2000.0f);
     float moonScale = 100.0f;
 
-    glm::mat4 moonModel = glm::mat4(1.0f);
+    moonModel = glm::mat4(1.0f);
     moonModel = glm::translate(moonModel, moonWorldPos);
     moonModel = glm::scale(moonModel, glm::vec3(moonScale));
 
-    GLint moonModelLoc = glGetUniformLocation(moonShader.shaderProgram, "model");
+    GLint moonModelLoc = moonShader.getUniformLocation("model");
     glUniformMatrix4fv(moonModelLoc, 1, GL_FALSE, glm::value_ptr(moonModel));
 
     glm::mat3 moonNormalMatrix =
         glm::mat3(glm::inverseTranspose(view * moonModel));
 
-    GLint moonNormalLoc = glGetUniformLocation(moonShader.shaderProgram, "normalMatrix");
+    GLint moonNormalLoc = moonShader.getUniformLocation("normalMatrix");
     glUniformMatrix3fv(moonNormalLoc, 1, GL_FALSE, glm::value_ptr(moonNormalMatrix));
 
+    moonViewLoc = moonShader.getUniformLocation("view");
+    moonProjectionLoc = moonShader.getUniformLocation("projection");
+
     myBasicShader.useShaderProgram();
 
     // Initialize ship uniforms
-    shipModelLoc = glGetUniformLocation(myBasicShader.shaderProgram, "model");
-    shipViewLoc = glGetUniformLocation(myBasicShader.shaderProgram, "view");
-    shipProjectionLoc = glGetUniformLocation(myBasicShader.shaderProgram, "projection");
-    shipNormalMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "normalMatrix");
-    shipLightDirLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightDir");
-    shipLightColorLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightColor");
+    shipModelLoc = myBasicShader.getUniformLocation("model");
+    shipViewLoc = myBasicShader.getUniformLocation("view");
+    shipProjectionLoc = myBasicShader.getUniformLocation("projection");
+    shipNormalMatrixLoc = myBasicShader.getUniformLocation("normalMatrix");
+    shipLightDirLoc = myBasicShader.getUniformLocation("lightDir");
+    shipLightColorLoc = myBasicShader.getUniformLocation("lightColor");
 
-    shipWorldMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "shipModelMatrix");
+    shipWorldMatrixLoc = myBasicShader.getUniformLocation("shipModelMatrix");
 
     // initialize ship transform and lamp positions/colors
     updateShipTransform();
 
     glUniformMatrix4fv(shipWorldMatrixLoc, 1, GL_FALSE, glm::value_ptr(shipModelMatrix));
 
-    lightSpaceTrMatrixLoc = glGetUniformLocation(myBasicShader.shaderProgram, "lightSpaceTrMatrix");
-    shadowMapLoc = glGetUniformLocation(myBasicShader.shaderProgram, "shadowMap");
-    glUniform1i(shadowMapLoc, 5);
+    lightSpaceTrMatricesLoc = myBasicShader.getUniformLocation("lightSpaceTrMatrices");
+    cascadeSplitsLoc = myBasicShader.getUniformLocation("cascadeSplits");
+    cascadeCountLoc = myBasicShader.getUniformLocation("cascadeCount");
+    shadowMapLoc = myBasicShader.getUniformLocation("shadowMap");
+    glUniform1i(shadowMapLoc, SHADOW_MAP_TEXTURE_UNIT);
+    glUniform1i(cascadeCountLoc, shadowCascades.getCascadeCount());
+    shadowFilterLoc = myBasicShader.getUniformLocation("shadowFilter");
 
     oceanShader.useShaderProgram();
-    oceanLightSpaceTrMatrixLoc = glGetUniformLocation(oceanShader.shaderProgram, "lightSpaceTrMatrix");
-    oceanShadowMapLoc = glGetUniformLocation(oceanShader.shaderProgram, "shadowMap");
-    glUniform1i(oceanShadowMapLoc, 5);
+    oceanLightSpaceTrMatricesLoc = oceanShader.getUniformLocation("lightSpaceTrMatrices");
+    oceanCascadeSplitsLoc = oceanShader.getUniformLocation("cascadeSplits");
+    oceanCascadeCountLoc = oceanShader.getUniformLocation("cascadeCount");
+    oceanShadowMapLoc = oceanShader.getUniformLocation("shadowMap");
+    glUniform1i(oceanShadowMapLoc, SHADOW_MAP_TEXTURE_UNIT);
+    glUniform1i(oceanCascadeCountLoc, shadowCascades.getCascadeCount());
+    oceanShadowFilterLoc = oceanShader.getUniformLocation("shadowFilter");
+    applyShadowFilter();
+
+    depthShader.useShaderProgram();
+    depthModelLoc = depthShader.getUniformLocation("model");
+    depthLightSpaceTrMatrixLoc = depthShader.getUniformLocation("lightSpaceTrMatrix");
 }
 
-void renderOcean(gps::Shader shader)
+void renderOcean(const gps::Shader& shader)
 {
-    // select active shader program
-    shader.useShaderProgram();
-
-    // update time uniform for wave animation
-    glUniform1f(oceanTimeLoc, (float)glfwGetTime());
-
     // single patch (foloseste oceanModel din initUniforms)
-    glUniformMatrix4fv(oceanModelLoc, 1, GL_FALSE, glm::value_ptr(oceanModel));
-
-    glm::mat3 oceanNormalMatrix = glm::mat3(glm::inverseTranspose(view * oceanModel));
-    glUniformMatrix3fv(oceanNormalMatrixLoc, 1, GL_FALSE, glm::value_ptr(oceanNormalMatrix));
-
-    ocean.Draw(shader);
+    sceneQueue.submit(shader, ocean, oceanModel, {oceanModelLoc, oceanNormalMatrixLoc});
 }
 
-void renderMoon(gps::Shader& shader)
+void renderMoon(const gps::Shader& shader)
 {
-    shader.useShaderProgram();
-
-    GLint viewLoc = glGetUniformLocation(shader.shaderProgram, "view");
-    GLint projLoc = glGetUniformLocation(shader.shaderProgram, "projection");
-
-    // fix moon on cer
-    glm::mat4 viewNoTranslate = glm::mat4(glm::mat3(view));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(viewNoTranslate));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    moon.Draw(shader);
+    // model and normal matrix are fixed in initUniforms; the shader drops the view translation,
+    // so for culling and sorting the moon travels with the camera
+    glm::mat4 moonPlacement = glm::translate(glm::mat4(1.0f), myCamera.getPosition()) * moonModel;
+    sceneQueue.submit(shader, moon, moonPlacement, {});
 }
 
-void renderSceneDepth()
+// static casters go into the cached shadow layers, dynamic ones are redrawn every frame
+void renderSceneDepth(bool staticCasters)
 {
-    depthShader.useShaderProgram();
-    GLint modelLoc = glGetUniformLocation(depthShader.shaderProgram, "model");
+    const gps::RenderQueue::ObjectUniforms depthUniforms = {depthModelLoc, -1};
 
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(oceanModel));
-    ocean.Draw(depthShader);
+    if (staticCasters)
+    {
+        shadowQueue.submit(depthShader, ocean, oceanModel, depthUniforms, true, false);
+        shadowQueue.submit(depthShader, ship, shipModelMatrix, depthUniforms, true, false);
 
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(shipModelMatrix));
-    ship.Draw(depthShader);
+        glm::mat4 chestMatrix = buildWorldMatrix(chestWorldPos, 0.2f, glm::vec3(0.0f, 270.0f, 0.0f));
+        shadowQueue.submit(depthShader, chest, chestMatrix, depthUniforms, false, false);
+        return;
+    }
 
     glm::mat4 teapotMatrix = (heldItem == HELD_TEAPOT)
         ? buildHeldMatrix(0.18f, glm::vec3(0.0f))
         : buildWorldMatrix(teapotWorldPos, 0.18f, glm::vec3(0.0f));
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(teapotMatrix));
-    teapot.Draw(depthShader);
+    shadowQueue.submit(depthShader, teapot, teapotMatrix, depthUniforms, true, false);
 
     glm::mat4 nanosuitMatrix = (heldItem == HELD_NANOSUIT)
         ? buildHeldMatrix(0.22f, glm::vec3(0.0f, 180.0f, 0.0f))
         : buildWorldMatrix(nanosuitWorldPos, 0.22f, glm::vec3(0.0f, 180.0f, 0.0f));
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(nanosuitMatrix));
-    nanosuit.Draw(depthShader);
-
-    glm::mat4 chestMatrix = buildWorldMatrix(chestWorldPos, 0.2f, glm::vec3(0.0f, 270.0f, 0.0f));
-    glDisable(GL_CULL_FACE);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(chestMatrix));
-    chest.Draw(depthShader);
-    glEnable(GL_CULL_FACE);
+    shadowQueue.submit(depthShader, nanosuit, nanosuitMatrix, depthUniforms, true, false);
 }
 
-void renderShip(gps::Shader& shader)
+void renderShadowCasters(int cascade, bool staticCasters)
 {
-    shader.useShaderProgram();
-
-    // Send ship model matrix
-    glUniformMatrix4fv(shipModelLoc, 1, GL_FALSE, glm::value_ptr(shipModelMatrix));
-
-    // Send view and projection matrices
-    glUniformMatrix4fv(shipViewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(shipProjectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    // Compute and send normal matrix
-    glm::mat3 shipNormalMatrix = glm::mat3(glm::inverseTranspose(view * shipModelMatrix));
-    glUniformMatrix3fv(shipNormalMatrixLoc, 1, GL_FALSE, glm::value_ptr(shipNormalMatrix));
-
-    // Send light parameters
-    glUniform3fv(shipLightDirLoc, 1, glm::value_ptr(lightDir));
-    glUniform3fv(shipLightColorLoc, 1, glm::value_ptr(lightColor));
+    shadowQueue.begin(shadowCascades.getSharedLightViewMatrix());
+    shadowQueue.setShadowFrustum(shadowCascades.getLightSpaceMatrix(cascade));
+    renderSceneDepth(staticCasters);
+    shadowFrameStats.meshesVisible += shadowQueue.getStats().meshesVisible;
+    shadowFrameStats.meshesCulled += shadowQueue.getStats().meshesCulled;
+    shadowFrameStats.trianglesSubmitted += shadowQueue.getStats().trianglesSubmitted;
+    shadowQueue.execute();
+}
 
-    ship.Draw(shader);
+void renderShip(const gps::Shader& shader)
+{
+    sceneQueue.submit(shader, ship, shipModelMatrix, {shipModelLoc, shipNormalMatrixLoc});
 }
 
-void renderTeapot(gps::Shader& shader)
+void renderTeapot(const gps::Shader& shader)
 {
     glm::mat4 teapotMatrix = (heldItem == HELD_TEAPOT)
                                  ? buildHeldMatrix(0.18f, glm::vec3(0.0f))
                                  : buildWorldMatrix(teapotWorldPos, 0.18f, glm::vec3(0.0f));
-    shader.useShaderProgram();
-
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(teapotMatrix));
-    glm::mat3 objectNormalMatrix = glm::mat3(glm::inverseTranspose(view * teapotMatrix));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(objectNormalMatrix));
-    teapot.Draw(shader);
+    sceneQueue.submit(shader, teapot, teapotMatrix, {modelLoc, normalMatrixLoc});
 }
 
-void renderNanosuit(gps::Shader& shader)
+void renderNanosuit(const gps::Shader& shader)
 {
     glm::mat4 nanosuitMatrix = (heldItem == HELD_NANOSUIT)
                                    ? buildHeldMatrix(0.22f, glm::vec3(0.0f, 180.0f, 0.0f))
                                    : buildWorldMatrix(nanosuitWorldPos, 0.22f, glm::vec3(0.0f, 180.0f, 0.0f));
-    shader.useShaderProgram();
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(nanosuitMatrix));
-    glm::mat3 objectNormalMatrix = glm::mat3(glm::inverseTranspose(view * nanosuitMatrix));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(objectNormalMatrix));
-    nanosuit.Draw(shader);
+    sceneQueue.submit(shader, nanosuit, nanosuitMatrix, {modelLoc, normalMatrixLoc});
 }
 
-void renderChest(gps::Shader& shader)
+void renderChest(const gps::Shader& shader)
 {
     glm::mat4 chestMatrix = buildWorldMatrix(chestWorldPos, 0.2f, glm::vec3(0.0f, 270.0f, 0.0f));
 
-    shader.useShaderProgram();
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(chestMatrix));
-    glm::mat3 objectNormalMatrix = glm::mat3(glm::inverseTranspose(view * chestMatrix));
-    glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, glm::value_ptr(objectNormalMatrix));
-
-    glDisable(GL_CULL_FACE);
-    chest.Draw(shader);
-    glEnable(GL_CULL_FACE);
+    // the chest is open, its inside faces must be visible
+    sceneQueue.submit(shader, chest, chestMatrix, {modelLoc, normalMatrixLoc}, false);
 }
 
 void renderDepthMapPass()
 {
-    lightSpaceTrMatrix = computeLightSpaceTrMatrix();
+    const WindowDimensions dimensions = myWindow.getWindowDimensions();
+    shadowCascades.update(view, glm::radians(CAMERA_FOV), (float)dimensions.width / (float)dimensions.height,
+                          CAMERA_NEAR_PLANE, lightDir);
     updateShipTransform();
     myBasicShader.useShaderProgram();
     glUniformMatrix4fv(shipWorldMatrixLoc, 1, GL_FALSE, glm::value_ptr(shipModelMatrix));
 
+    // the ship is the only static caster that can move
+    if (shipYaw != shadowCachedShipYaw)
+    {
+        shadowCascades.invalidate();
+        shadowCachedShipYaw = shipYaw;
+    }
+
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    depthShader.useShaderProgram();
-    glUniformMatrix4fv(glGetUniformLocation(depthShader.shaderProgram, "lightSpaceTrMatrix"),
-                       1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    renderSceneDepth();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    shadowFrameStats = gps::RenderQueue::Stats();
+    shadowPassTimer.begin();
+    for (int cascade = 0; cascade < shadowCascades.getCascadeCount(); cascade++)
+    {
+        depthShader.useShaderProgram();
+        glUniformMatrix4fv(depthLightSpaceTrMatrixLoc, 1, GL_FALSE,
+                           glm::value_ptr(shadowCascades.getLightSpaceMatrix(cascade)));
+
+        if (shadowCascades.needsStaticRender(cascade))
+        {
+            shadowCascades.beginStatic(cascade);
+            renderShadowCasters(cascade, true);
+        }
+        shadowCascades.beginCascade(cascade);
+        renderShadowCasters(cascade, false);
+    }
+    shadowCascades.end();
+    shadowPassTimer.end();
     applyRenderMode();
 }
 
+// per-program uniforms shared by every object drawn this frame
 void renderScenePass()
 {
     glViewport(0, 0, myWindow.getWindowDimensions().width, myWindow.getWindowDimensions().height);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, depthMapTexture);
+    gps::GLState::bindTexture(SHADOW_MAP_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, shadowCascades.getTexture());
 
+    const GLsizei cascadeCount = shadowCascades.getCascadeCount();
     myBasicShader.useShaderProgram();
-    glUniformMatrix4fv(lightSpaceTrMatrixLoc, 1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
+    glUniformMatrix4fv(lightSpaceTrMatricesLoc, cascadeCount, GL_FALSE,
+                       glm::value_ptr(shadowCascades.getLightSpaceMatrices()[0]));
+    glUniform1fv(cascadeSplitsLoc, cascadeCount, shadowCascades.getSplitDistances());
+    glUniformMatrix4fv(shipViewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(shipProjectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3fv(shipLightDirLoc, 1, glm::value_ptr(lightDir));
+    glUniform3fv(shipLightColorLoc, 1, glm::value_ptr(lightColor));
 
     oceanShader.useShaderProgram();
-    glUniformMatrix4fv(oceanLightSpaceTrMatrixLoc, 1, GL_FALSE, glm::value_ptr(lightSpaceTrMatrix));
+    glUniformMatrix4fv(oceanLightSpaceTrMatricesLoc, cascadeCount, GL_FALSE,
+                       glm::value_ptr(shadowCascades.getLightSpaceMatrices()[0]));
+    glUniform1fv(oceanCascadeSplitsLoc, cascadeCount, shadowCascades.getSplitDistances());
+    // update time uniform for wave animation
+    glUniform1f(oceanTimeLoc, (float)appTime());
+
+    moonShader.useShaderProgram();
+    // fix moon on cer
+    glm::mat4 viewNoTranslate = glm::mat4(glm::mat3(view));
+    glUniformMatrix4fv(moonViewLoc, 1, GL_FALSE, glm::value_ptr(viewNoTranslate));
+    glUniformMatrix4fv(moonProjectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+
+    sceneQueue.begin(view);
+    sceneQueue.setFrustum(projection * view);
+}
+
+void printFrameStats()
+{
+    const gps::GLState::Counters& frame = gps::GLState::lastFrame();
+    frameStatsTotals.issued += frame.issued;
+    frameStatsTotals.skipped += frame.skipped;
+    frameStatsTotals.drawCalls += frame.drawCalls;
+    sceneStatsTotals.meshesVisible += sceneQueue.getStats().meshesVisible;
+    sceneStatsTotals.meshesCulled += sceneQueue.getStats().meshesCulled;
+    sceneStatsTotals.trianglesSubmitted += sceneQueue.getStats().trianglesSubmitted;
+    shadowStatsTotals.meshesVisible += shadowFrameStats.meshesVisible;
+    shadowStatsTotals.meshesCulled += shadowFrameStats.meshesCulled;
+    shadowStatsTotals.trianglesSubmitted += shadowFrameStats.trianglesSubmitted;
+    double shadowPassGpuMs = 0.0;
+    if (shadowPassTimer.poll(shadowPassGpuMs))
+    {
+        shadowPassGpuMsTotal += shadowPassGpuMs;
+        shadowPassGpuSamples++;
+    }
+    frameStatsFrames++;
+
+    double now = glfwGetTime();
+    if (now - frameStatsWindowStart < 1.0)
+    {
+        return;
+    }
+
+    if (frameStatsEnabled && frameStatsFrames > 0)
+    {
+        // only the binds and program/cull changes GLState dropped; the per-draw uniform lookups,
+        // sampler uniforms and texture unbinds were removed from the code itself and are not counted
+        std::cout << "Frame: " << frameStatsFrames << " fps, "
+                  << frameStatsTotals.drawCalls / frameStatsFrames << " draws, tracked state calls "
+                  << frameStatsTotals.issued / frameStatsFrames << " issued, "
+                  << frameStatsTotals.skipped / frameStatsFrames << " redundant skipped"
+                  << std::endl;
+        std::cout << "  scene: " << sceneStatsTotals.meshesVisible / frameStatsFrames << " meshes visible, "
+                  << sceneStatsTotals.meshesCulled / frameStatsFrames << " culled, "
+                  << sceneStatsTotals.trianglesSubmitted / frameStatsFrames << " triangles; shadow: "
+                  << shadowStatsTotals.meshesVisible / frameStatsFrames << " caster meshes, "
+                  << shadowStatsTotals.meshesCulled / frameStatsFrames << " culled, "
+                  << shadowStatsTotals.trianglesSubmitted / frameStatsFrames << " triangles, "
+                  << shadowCascades.getStaticRenderCount() - frameStatsStaticRenders << " cascade re-renders/s"
+                  << std::endl;
+        if (shadowPassGpuSamples > 0)
+        {
+            std::cout << "  shadow pass GPU: " << shadowPassGpuMsTotal / shadowPassGpuSamples << " ms" << std::endl;
+        }
+        if (collisionStats.moves > 0)
+        {
+            std::cout << "  collision: " << collisionStats.cpuMs / frameStatsFrames << " ms/frame, "
+                      << collisionStats.cpuMs * 1000.0 / collisionStats.moves << " us/move, "
+                      << collisionStats.trianglesTested / frameStatsFrames << " triangle tests, "
+                      << collisionStats.contacts / frameStatsFrames << " contacts per frame" << std::endl;
+        }
+        if (framePacingSamples > 0)
+        {
+            std::cout << "  pacing: frame " << framePacingTotal / framePacingSamples * 1000.0 << " ms avg, "
+                      << framePacingMin * 1000.0 << " min, " << framePacingMax * 1000.0 << " max; "
+                      << simulationStepsWindow << " sim steps/s; swap interval " << swapInterval << std::endl;
+        }
+    }
+    collisionStats = gps::CapsuleCollider::Stats();
+    framePacingSamples = 0;
+    framePacingTotal = 0.0;
+    simulationStepsWindow = 0;
+    shadowPassGpuMsTotal = 0.0;
+    shadowPassGpuSamples = 0;
+    frameStatsStaticRenders = shadowCascades.getStaticRenderCount();
+
+    frameStatsWindowStart = now;
+    frameStatsFrames = 0;
+    frameStatsTotals = gps::GLState::Counters();
+    sceneStatsTotals = gps::RenderQueue::Stats();
+    shadowStatsTotals = gps::RenderQueue::Stats();
 }
 
 void renderScene()
 {
+    gps::GLState::beginFrame();
+    printFrameStats();
+
     //render the scene
-    renderDepthMapPass();
-    renderScenePass();
+    {
+        gps::Profiler::Zone zone("renderDepthMapPass");
+        renderDepthMapPass();
+    }
+    {
+        gps::Profiler::Zone zone("renderScenePass");
+        renderScenePass();
+    }
 
-    renderOcean(oceanShader);
-    renderShip(myBasicShader);
-    renderTeapot(myBasicShader);
-    renderNanosuit(myBasicShader);
-    renderChest(myBasicShader);
-    renderMoon(moonShader);
+    // the render* calls only queue draws, the GL work happens in execute()
+    {
+        gps::Profiler::Zone zone("renderOcean");
+        renderOcean(oceanShader);
+    }
+    {
+        gps::Profiler::Zone zone("renderShip");
+        renderShip(myBasicShader);
+    }
+    {
+        gps::Profiler::Zone zone("renderTeapot");
+        renderTeapot(myBasicShader);
+    }
+    {
+        gps::Profiler::Zone zone("renderNanosuit");
+        renderNanosuit(myBasicShader);
+    }
+    {
+        gps::Profiler::Zone zone("renderChest");
+        renderChest(myBasicShader);
+    }
+    {
+        gps::Profiler::Zone zone("renderMoon");
+        renderMoon(moonShader);
+    }
+    {
+        gps::Profiler::Zone zone("sceneQueue.execute");
+        sceneQueue.execute();
+    }
 
+    gps::Profiler::Zone zone("skybox");
     mySkyBox.Draw(skyboxShader, view, projection);
 }
 
+// edited shader sources are recompiled in the background and swapped in between frames
+void reloadShaders()
+{
+    // the sources are stat'ed twice a second, pending compiles are checked every frame
+    double now = glfwGetTime();
+    bool checkFiles = now - shaderReloadLastCheck >= 0.5;
+    if (checkFiles)
+    {
+        shaderReloadLastCheck = now;
+    }
+
+    bool swapped = false;
+    for (gps::Shader* shader : {&myBasicShader, &oceanShader, &moonShader, &skyboxShader, &depthShader})
+    {
+        swapped |= shader->pollReload(checkFiles) == gps::Shader::RELOAD_SWAPPED;
+    }
+
+    if (swapped)
+    {
+        // new programs start with default uniform values and fresh locations
+        gps::Mesh::bindSamplerUnits(myBasicShader);
+        gps::Mesh::bindSamplerUnits(oceanShader);
+        gps::Mesh::bindSamplerUnits(moonShader);
+        initUniforms();
+    }
+}
+
+void recordFramePacing(double frameDelta)
+{
+    framePacingMin = (framePacingSamples == 0) ? frameDelta : std::min(framePacingMin, frameDelta);
+    framePacingMax = (framePacingSamples == 0) ? frameDelta : std::max(framePacingMax, frameDelta);
+    framePacingTotal += frameDelta;
+    framePacingSamples++;
+}
+
+// runs every whole step the frame time covers
+void stepSimulation(double frameDelta)
+{
+    simulationAccumulator += std::min(frameDelta, MAX_FRAME_DELTA);
+    while (simulationAccumulator >= SIMULATION_STEP)
+    {
+        previousCameraPosition = myCamera.getPosition();
+        processMovement(static_cast<float>(SIMULATION_STEP));
+        simulationAccumulator -= SIMULATION_STEP;
+        simulationStepsWindow++;
+    }
+}
+
+// draws the camera blended between the last two simulation steps, leaves the simulated state untouched
+void renderInterpolated()
+{
+    if (introActive)
+    {
+        // the intro places the camera from the clock each frame, nothing to blend
+        previousCameraPosition = myCamera.getPosition();
+        renderScene();
+        return;
+    }
+
+    float alpha = static_cast<float>(simulationAccumulator / SIMULATION_STEP);
+    glm::vec3 simulatedPosition = myCamera.getPosition();
+    myCamera.setPosition(glm::mix(previousCameraPosition, simulatedPosition, alpha));
+    updateViewUniforms();
+    renderScene();
+    myCamera.setPosition(simulatedPosition);
+}
+
+// Renders the intro path with a fixed time step, looping it when more frames are asked for.
+// Every frame ends with glFinish so frame times include the GPU work of that frame.
+int runBenchmark()
+{
+    const int frames = (benchmarkFrames > 0) ? benchmarkFrames
+                                             : static_cast<int>(std::ceil(introDuration / BENCHMARK_TIME_STEP));
+
+    gps::Benchmark::FlythroughReport report;
+    report.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    report.width = myWindow.getWindowDimensions().width;
+    report.height = myWindow.getWindowDimensions().height;
+    report.timeStepMs = BENCHMARK_TIME_STEP * 1000.0;
+    report.frameMs.reserve(frames);
+
+    // warm-up frames at t = 0 absorb first-use costs (shader compiles, texture residency)
+    for (int frame = -BENCHMARK_WARMUP_FRAMES; frame < frames; frame++)
+    {
+        if (frame == 0)
+        {
+            gps::Profiler::flush();
+            gps::Profiler::resetTotals();
+        }
+
+        benchmarkTime = std::fmod(std::max(frame, 0) * BENCHMARK_TIME_STEP, static_cast<double>(introDuration));
+        introActive = true;
+
+        auto frameStart = std::chrono::steady_clock::now();
+        gps::Profiler::beginFrame();
+        {
+            gps::Profiler::Zone zone("intro");
+            intro();
+        }
+        {
+            gps::Profiler::Zone zone("renderScene");
+            renderScene();
+        }
+        {
+            gps::Profiler::Zone zone("swap+finish");
+            glfwSwapBuffers(myWindow.getWindow());
+            glFinish();
+        }
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+        if (frame >= 0)
+        {
+            report.frameMs.push_back(frameMs);
+            report.sceneTriangles += sceneQueue.getStats().trianglesSubmitted;
+            report.shadowTriangles += shadowFrameStats.trianglesSubmitted;
+            // closed by renderScene, so this is the previous frame's count
+            report.drawCalls += gps::GLState::lastFrame().drawCalls;
+        }
+    }
+
+    gps::Profiler::flush();
+    report.zones = gps::Profiler::getTotals();
+    report.zoneFrames = gps::Profiler::getTotalFrames();
+    report.sceneTriangles /= frames;
+    report.shadowTriangles /= frames;
+    report.drawCalls /= frames;
+
+    return gps::Benchmark::writeFlythroughReport(benchmarkOutput, report) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 void cleanup()
 {
-    glDeleteFramebuffers(1, &shadowMapFBO);
-    glDeleteTextures(1, &depthMapTexture);
+    gps::Profiler::shutdown();
+    shadowCascades.destroy();
     myWindow.Delete();
     //cleanup code for your own data
 }
 
 int main(int argc, const char* argv[])
 {
+    int exitCode;
+    if (!parseCommandLine(argc, argv, exitCode))
+    {
+        return exitCode;
+    }
+
     try
     {
         initOpenGLWindow();
@@ -1054,24 +1610,70 @@ int main(int argc, const char* argv[])
 
     initOpenGLState();
     initShadowMap();
-    initModels();
+    try
+    {
+        initModels();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        cleanup();
+        return EXIT_FAILURE;
+    }
     initObjectPositions();
     initShaders();
     initSkybox();
     initUniforms();
-    setWindowCallbacks();
+    if (!benchmarkMode)
+    {
+        setWindowCallbacks();
+    }
     introActive = true;
     shipYaw = 0.0f;
-    introStartTime = static_cast<float>(glfwGetTime());
+    introStartTime = static_cast<float>(appTime());
     resetMouseState = true;
 
+    // loading and setup bound textures/programs directly, sync the tracker with the real state
+    gps::GLState::invalidate();
+    gps::Profiler::init();
+
+    if (benchmarkMode)
+    {
+        exitCode = runBenchmark();
+        cleanup();
+        return exitCode;
+    }
+
     // application loop
+    glfwSwapInterval(swapInterval);
+    previousCameraPosition = myCamera.getPosition();
+    double previousFrameTime = glfwGetTime();
     while (!glfwWindowShouldClose(myWindow.getWindow()))
     {
-        intro();
-        processMovement();
-        renderScene();
+        double frameTime = glfwGetTime();
+        double frameDelta = frameTime - previousFrameTime;
+        previousFrameTime = frameTime;
+        recordFramePacing(frameDelta);
+
+        gps::Profiler::beginFrame();
+        {
+            gps::Profiler::Zone zone("reloadShaders");
+            reloadShaders();
+        }
+        {
+            gps::Profiler::Zone zone("intro");
+            intro();
+        }
+        {
+            gps::Profiler::Zone zone("processMovement");
+            stepSimulation(frameDelta);
+        }
+        {
+            gps::Profiler::Zone zone("renderScene");
+            renderInterpolated();
+        }
 
+        gps::Profiler::Zone zone("pollEvents+swap");
         glfwPollEvents();
         glfwSwapBuffers(myWindow.getWindow());
     }
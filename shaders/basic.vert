@@ -9,13 +9,12 @@ layout(location=2) in vec2 vTexCoords;
 out vec3 fPosition;
 out vec3 fNormal;
 out vec2 fTexCoords;
-out vec4 fragPosLightSpace;
+out vec3 fWorldPos;
 
 // matrices
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform mat4 lightSpaceTrMatrix;
 
 void main()
 {
@@ -26,5 +25,5 @@ void main()
     fTexCoords = vTexCoords;
 
     gl_Position = projection * view * worldPos;
-    fragPosLightSpace = lightSpaceTrMatrix * worldPos;
+    fWorldPos = worldPos.xyz;
 }
@@ -1,8 +0,0 @@
-#version 410 core
-
-out vec4 fColor;
-
-void main()
-{
-    fColor = vec4(1.0f);
-}
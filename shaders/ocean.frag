@@ -4,7 +4,7 @@
 in vec3 fPosition;
 in vec3 fNormal;
 in vec2 fTexCoords;
-in vec4 fragPosLightSpace;
+in vec3 fWorldPos;
 
 // output color
 out vec4 fColor;
@@ -21,7 +21,27 @@ uniform vec3 lightColor;
 // textures
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
-uniform sampler2D shadowMap;
+uniform sampler2DArrayShadow shadowMap;
+
+// shadow cascades, cascadeSplits holds the far view distance of each one
+const int MAX_CASCADES = 4;
+uniform mat4 lightSpaceTrMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];
+uniform int cascadeCount;
+
+// soft-shadow kernel: 0 single tap, 1 PCF 3x3, 2 PCF 5x5, 3 Poisson disc of 16 taps
+uniform int shadowFilter;
+
+const vec2 poissonDisk[16] = vec2[](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
 
 // lighting parameters
 const float ambientStrength = 0.20;
@@ -40,8 +60,19 @@ void computeDirLight(vec3 normalEye, vec3 viewDir, out vec3 ambient, out vec3 di
     specular = specularStrength * spec * lightColor;
 }
 
-float computeShadow(vec3 normalEye)
+float computeShadow(vec3 normalEye, float viewDepth)
 {
+    int cascade = 0;
+    while (cascade < cascadeCount && viewDepth > cascadeSplits[cascade])
+    {
+        cascade++;
+    }
+    if (cascade >= cascadeCount)
+    {
+        return 0.0f;
+    }
+
+    vec4 fragPosLightSpace = lightSpaceTrMatrices[cascade] * vec4(fWorldPos, 1.0f);
     vec3 normalizedCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     normalizedCoords = normalizedCoords * 0.5 + 0.5;
 
@@ -53,11 +84,40 @@ float computeShadow(vec3 normalEye)
     vec3 lightDirEye = normalize(vec3(view * vec4(lightDir, 0.0)));
     float bias = max(0.05f * (1.0f - dot(normalEye, lightDirEye)), 0.005f);
 
-    float closestDepth = texture(shadowMap, normalizedCoords.xy).r;
-    float currentDepth = normalizedCoords.z;
-    float shadow = currentDepth - bias > closestDepth ? 1.0f : 0.0f;
+    // every lookup is a hardware comparison, bilinearly filtered over 2x2 texels
+    float layer = float(cascade);
+    float reference = normalizedCoords.z - bias;
+    vec2 texelSize = 1.0f / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0f;
+
+    if (shadowFilter == 0)
+    {
+        lit = texture(shadowMap, vec4(normalizedCoords.xy, layer, reference));
+    }
+    else if (shadowFilter == 3)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            vec2 offset = poissonDisk[i] * 2.5f * texelSize;
+            lit += texture(shadowMap, vec4(normalizedCoords.xy + offset, layer, reference));
+        }
+        lit /= 16.0f;
+    }
+    else
+    {
+        int radius = shadowFilter;
+        for (int y = -radius; y <= radius; y++)
+        {
+            for (int x = -radius; x <= radius; x++)
+            {
+                vec2 offset = vec2(x, y) * texelSize;
+                lit += texture(shadowMap, vec4(normalizedCoords.xy + offset, layer, reference));
+            }
+        }
+        lit /= float((2 * radius + 1) * (2 * radius + 1));
+    }
 
-    return shadow;
+    return 1.0f - lit;
 }
 
 float computeFog(vec3 fPosEye)
@@ -85,7 +145,7 @@ void main()
     vec3 baseColor = texture(diffuseTexture, fTexCoords).rgb;
     vec3 specMap = texture(specularTexture, fTexCoords).rgb;
 
-    float shadow = computeShadow(normalEye);
+    float shadow = computeShadow(normalEye, -fPosEye.z);
     vec3 color = ambient * baseColor + (1.0f - shadow) * diffuse * baseColor +
                  (1.0f - shadow) * specular * specMap;
 
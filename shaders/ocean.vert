@@ -9,14 +9,13 @@ layout(location = 2) in vec2 vTexCoords;
 out vec3 fPosition;
 out vec3 fNormal;
 out vec2 fTexCoords;
-out vec4 fragPosLightSpace;
+out vec3 fWorldPos;
 
 // matrices
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform mat3 normalMatrix;
-uniform mat4 lightSpaceTrMatrix;
 
 // time
 uniform float time;
@@ -52,7 +51,8 @@ void main()
     fNormal = n;
     fTexCoords = vTexCoords;
 
-    gl_Position = projection * view * model * vec4(pos, 1.0);
-    fragPosLightSpace = lightSpaceTrMatrix * model * vec4(pos, 1.0);
+    vec4 worldPos = model * vec4(pos, 1.0);
+    gl_Position = projection * view * worldPos;
+    fWorldPos = worldPos.xyz;
 }
 